@@ -6,6 +6,7 @@
 #include "PlotFieldIsolines.h"
 #include "PlotField.h"
 #include "PlotModelFieldError.h"
+#include "console_util.h"
 
 
 void calculateFieldModelProblem(const ProgramOptsHandler& optsHandler, Solution& solution)
@@ -21,6 +22,7 @@ void calculateFieldModelProblem(const ProgramOptsHandler& optsHandler, Solution&
     }
 
     std::filesystem::path fieldPath = intermediate_file_path(generate_file_name("field-model", "dat", "-"));
+    std::filesystem::path sampledFieldPath = intermediate_file_path(generate_file_name("field-model", "dat", "-", "sampled"));
     std::filesystem::path errorPath = intermediate_file_path(generate_file_name("field-model", "dat", "-", "error"));
     std::filesystem::path gridIntPath = intermediate_file_path(generate_file_name("field-model", "dat", "-", "grid", "int"));
     std::filesystem::path gridExtPath = intermediate_file_path(generate_file_name("field-model", "dat", "-", "grid", "ext"));
@@ -28,6 +30,7 @@ void calculateFieldModelProblem(const ProgramOptsHandler& optsHandler, Solution&
     printf("Saving results to files...\n");
 
     solution.writeFieldData(fieldPath);
+    solution.writeSampledFieldData(sampledFieldPath);
     solution.writeFieldErrorData(errorPath);
     solution.writeInternalGridData(gridIntPath);
     solution.writeExternalGridData(gridExtPath);
@@ -51,13 +54,13 @@ void calculateFieldModelProblem(const ProgramOptsHandler& optsHandler, Solution&
     if (programParams.isPlotFieldIsolinesEnabled)
     {
         printf("Plotting magnetic field isolines...\n\n");
-        plotFieldIsolines.plot(fieldPath, fluidPath);
+        plotFieldIsolines.plot(sampledFieldPath, fluidPath);
     }
 
     if (programParams.isPlotFieldEnabled)
     {
         printf("Plotting magnetic field...\n\n");
-        plotField.plot(fieldPath, fluidPath);
+        plotField.plot(sampledFieldPath, fluidPath);
     }
 
     if (programParams.isPlotFieldErrorEnabled)
@@ -75,6 +78,170 @@ void calculateFieldModelProblem(const ProgramOptsHandler& optsHandler, Solution&
 }
 
 
+ResultCode calcMainResult(Solution& solution, const std::vector<SolutionState>& warmStates, size_t index)
+{
+    ResultCode resultCode = ResultCode::INVALID_RESULT;
+
+    // previous chi's result at the same w is tried first, continuation in w from the last result is the fallback,
+    // later results keep the continuation history of this chi, so predictors still see its last results
+    if (index < warmStates.size())
+    {
+        print_message("Starting from the previous chi result at W = %.6f...\n\n", warmStates[index].w);
+
+        if (index > 0)
+        {
+            resultCode = solution.calcWarmResult(warmStates[index]);
+        }
+        else
+        {
+            solution.calcInitials(warmStates[index]);
+            resultCode = solution.calcResult(warmStates[index].w);
+        }
+
+        if (resultCode == ResultCode::SUCCESS || resultCode == ResultCode::TARGET_REACHED)
+        {
+            return resultCode;
+        }
+
+        print_message("Previous chi result is not continued, W continuation is used\n\n");
+    }
+
+    if (index == 0)
+    {
+        solution.calcInitials();
+        return solution.calcResult(0.0);
+    }
+
+    return solution.calcNextResult();
+}
+
+
+typedef struct chi_results_t
+{
+    std::vector<std::filesystem::path> fluidDatas;
+    std::filesystem::path fieldData;
+    std::filesystem::path sampledFieldData;
+    std::filesystem::path internalGridData;
+    std::filesystem::path externalGridData;
+    std::filesystem::path heightCoefsData;
+} ChiResults;
+
+
+void flushChiMessages(double chi, double w)
+{
+    // buffered output of a parallel chi worker is released at every result, so progress stays visible
+    print_message("Chi = %.6f: W = %.6f result finished\n\n", chi, w);
+    flush_messages();
+}
+
+
+ResultCode calcChiResults(const ProgramParams& programParams, 
+                          Solution& solution, 
+                          double chi, 
+                          std::vector<SolutionState>& warmStates, 
+                          ChiResults& results)
+{
+    std::vector<Vector2<double>> heightCoefs;
+    std::vector<SolutionState> nextWarmStates;
+    ResultCode resultCode = ResultCode::SUCCESS;
+
+    solution.resetIterationsCounters();
+    solution.setChi(chi);
+
+    resultCode = calcMainResult(solution, warmStates, 0);
+    flushChiMessages(chi, solution.currentW());
+
+    if (programParams.isWarmStartChi && 
+        (resultCode == ResultCode::SUCCESS || resultCode == ResultCode::TARGET_REACHED))
+    {
+        nextWarmStates.push_back(solution.currentState());
+    }
+
+    if ((resultCode == ResultCode::SUCCESS && programParams.resultsNumW > 1) || resultCode == ResultCode::TARGET_REACHED)
+    {
+        results.fluidDatas.push_back(solution.writeFluidData());
+        heightCoefs.push_back({ solution.currentW(), solution.heightCoef() });
+    }
+
+    for (size_t j = 1; resultCode == ResultCode::SUCCESS; j++)
+    {
+        resultCode = calcMainResult(solution, warmStates, j);
+        flushChiMessages(chi, solution.currentW());
+
+        if (programParams.isWarmStartChi && 
+            (resultCode == ResultCode::SUCCESS || resultCode == ResultCode::TARGET_REACHED))
+        {
+            nextWarmStates.push_back(solution.currentState());
+        }
+
+        if (resultCode == ResultCode::SUCCESS || resultCode == ResultCode::TARGET_REACHED)
+        {
+            results.fluidDatas.push_back(solution.writeFluidData());
+            heightCoefs.push_back({ solution.currentW(), solution.heightCoef() });
+        }
+    }
+
+    warmStates = std::move(nextWarmStates);
+
+    if (resultCode != ResultCode::TARGET_REACHED)
+    {
+        return resultCode;
+    }
+
+    print_message("Saving results to files...\n");
+
+    results.fieldData = solution.writeFieldData();
+    results.sampledFieldData = solution.writeSampledFieldData();
+    results.internalGridData = solution.writeInternalGridData();
+    results.externalGridData = solution.writeExternalGridData();
+    results.heightCoefsData = write_height_coefs_data(chi, heightCoefs);
+
+    print_message("Results saved\n\n");
+
+    return resultCode;
+}
+
+
+void plotChiResults(const ProgramParams& programParams, const PlotParams& plotsParams, const ChiResults& results)
+{
+    PlotFluid fluidPlot(plotsParams);
+    PlotSTGrid gridPlot(plotsParams);
+    PlotFieldIsolines isolinesPlot(plotsParams);
+    PlotField fieldPlot(plotsParams);
+
+    if (programParams.isPlotFluidSurfaceEnabled)
+    {
+        printf("Plotting fluid surface...\n\n");
+        fluidPlot.plot(results.fluidDatas);
+    }
+
+    if (programParams.isPlotFieldGridEnabled)
+    {
+        printf("Plotting magnetic field grid...\n\n");
+        gridPlot.plot(results.internalGridData, results.externalGridData);
+    }
+
+    if (programParams.isPlotFieldIsolinesEnabled)
+    {
+        printf("Plotting magnetic field isolines...\n\n");
+        isolinesPlot.plot(results.sampledFieldData, results.fluidDatas.back());
+    }
+
+    if (programParams.isPlotFieldEnabled)
+    {
+        printf("Plotting magnetic field...\n\n");
+        fieldPlot.plot(results.sampledFieldData, results.fluidDatas.back());
+    }
+
+    system("pause");
+
+    fluidPlot.close();
+    gridPlot.close();
+    isolinesPlot.close();
+    fieldPlot.close();
+}
+
+
 void calculateMainProblem(const ProgramOptsHandler& optsHandler, Solution& solution)
 {
     ProgramParams programParams = optsHandler.parameters();
@@ -101,88 +268,61 @@ void calculateMainProblem(const ProgramOptsHandler& optsHandler, Solution& solut
     }
 
     std::vector<std::filesystem::path> heightCoefsDatas;
+    std::vector<ChiResults> chiResults(programParams.resultsNumChi);
+    std::vector<ResultCode> resultCodes(programParams.resultsNumChi, ResultCode::TARGET_REACHED);
+    bool isParallel = programParams.chiThreadsNum > 1 && programParams.resultsNumChi > 1;
 
-    for (int i = 0; i < programParams.resultsNumChi; i++)
+    if (isParallel)
     {
-        std::vector<Vector2<double>> heightCoefs;
-        std::vector<std::filesystem::path> fluidDatas;
-        ResultCode resultCode = ResultCode::SUCCESS;
-        double volumeNonDimMul = 1.0;
-
-        solution.resetIterationsCounters();
-        solution.setChi(curChi);
-        solution.calcInitials();
-        resultCode = solution.calcResult(0.0);
-
-        if ((resultCode == ResultCode::SUCCESS && programParams.resultsNumW > 1) || resultCode == ResultCode::TARGET_REACHED)
+        if (programParams.isWarmStartChi)
         {
-            fluidDatas.push_back(solution.writeFluidData());
-            heightCoefs.push_back({ solution.currentW(), solution.heightCoef() });
+            printf("Chi values are calculated in parallel, warm start from the previous chi is not used\n\n");
         }
 
-        while (resultCode == ResultCode::SUCCESS)
-        {
-            resultCode = solution.calcNextResult();
-
-            if (resultCode == ResultCode::SUCCESS || resultCode == ResultCode::TARGET_REACHED)
-            {
-                fluidDatas.push_back(solution.writeFluidData());
-                heightCoefs.push_back({ solution.currentW(), solution.heightCoef() });
-            }
-        }
+        printf("Calculating %d chi values on %d threads...\n\n", programParams.resultsNumChi, programParams.chiThreadsNum);
 
-        if (resultCode != ResultCode::TARGET_REACHED)
-        {
-            printf("Target W parameter can't be reached\n\n");
-            system("pause");
-            return;
-        }
+        ProblemParams problemParams = optsHandler.problemParameters();
+        ProgramParams parallelParams = programParams;
 
-        printf("Saving results to files...\n");
+        parallelParams.isWarmStartChi = false;
+        intermediate_path(); // intermediate directory is created before the workers write to it
 
-        std::filesystem::path fieldData = solution.writeFieldData();
-        std::filesystem::path internalGridData = solution.writeInternalGridData();
-        std::filesystem::path externalGridData = solution.writeExternalGridData();
-        
-        heightCoefsDatas.push_back(write_height_coefs_data(curChi, heightCoefs));
+        // every chi value has its own solution, so the workers share nothing but the output
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(programParams.chiThreadsNum)
+        for (int i = 0; i < programParams.resultsNumChi; i++)
+        {
+            double chi = programParams.chiInitial + i * stepChi;
+            Solution chiSolution(problemParams);
+            std::vector<SolutionState> warmStates;
 
-        printf("Results saved\n\n");
+            start_messages_buffering();
+            print_message("=========================== CHI = %.6f ===========================\n\n", chi);
 
-        PlotFluid fluidPlot(plotsParams);
-        PlotSTGrid gridPlot(plotsParams);
-        PlotFieldIsolines isolinesPlot(plotsParams);
-        PlotField fieldPlot(plotsParams);
+            resultCodes[i] = calcChiResults(parallelParams, chiSolution, chi, warmStates, chiResults[i]);
 
-        if (programParams.isPlotFluidSurfaceEnabled)
-        {
-            printf("Plotting fluid surface...\n\n");
-            fluidPlot.plot(fluidDatas);
+            stop_messages_buffering();
         }
+    }
 
-        if (programParams.isPlotFieldGridEnabled)
-        {
-            printf("Plotting magnetic field grid...\n\n");
-            gridPlot.plot(internalGridData, externalGridData);
-        }
+    std::vector<SolutionState> warmStates;
 
-        if (programParams.isPlotFieldIsolinesEnabled)
+    for (int i = 0; i < programParams.resultsNumChi; i++)
+    {
+        if (!isParallel)
         {
-            printf("Plotting magnetic field isolines...\n\n");
-            isolinesPlot.plot(fieldData, fluidDatas.back());
+            resultCodes[i] = calcChiResults(programParams, solution, curChi, warmStates, chiResults[i]);
         }
 
-        if (programParams.isPlotFieldEnabled)
+        if (resultCodes[i] != ResultCode::TARGET_REACHED)
         {
-            printf("Plotting magnetic field...\n\n");
-            fieldPlot.plot(fieldData, fluidDatas.back());
+            printf("Target W parameter can't be reached\n\n");
+            system("pause");
+            return;
         }
 
-        system("pause");
+        heightCoefsDatas.push_back(chiResults[i].heightCoefsData);
 
-        fluidPlot.close();
-        gridPlot.close();
-        isolinesPlot.close();
-        fieldPlot.close();
+        plotChiResults(programParams, plotsParams, chiResults[i]);
 
         curChi += stepChi;
     }
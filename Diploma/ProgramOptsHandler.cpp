@@ -16,6 +16,14 @@ enum OptsIds
     ITERATIONS_MAX_NUM_OPT,
     W_RESULTS_NUM_OPT,
     CHI_RESULTS_NUM_OPT,
+    GRID_LEVELS_NUM_OPT,
+    ERROR_TOLERANCE_OPT,
+    FIELD_ERROR_TOLERANCE_OPT,
+    REFINEMENTS_MAX_NUM_OPT,
+    ANDERSON_DEPTH_OPT,
+    COUPLING_ANDERSON_DEPTH_OPT,
+    RELAXATION_CANDIDATES_NUM_OPT,
+    CHI_THREADS_NUM_OPT,
     FIELD_SURFACE_SPLITS_NUM_OPT,
     FIELD_INTERNAL_SPLITS_NUM_OPT,
     FIELD_EXTERNAL_SPLITS_NUM_OPT,
@@ -30,6 +38,12 @@ enum OptsIds
     EQUAL_AXIS_OPT,
     DIMENSIONLESS_OPT,
     PEDANTIC_RIGHT_SWEEP_OPT,
+    FLUID_NEWTON_OPT,
+    FLUID_SPECTRAL_OPT,
+    INEXACT_COUPLING_OPT,
+    SECANT_PREDICTOR_OPT,
+    ARCLENGTH_CONTINUATION_OPT,
+    WARM_START_CHI_OPT,
     MAIN_PROBLEM_OPT,
     FIELD_MODEL_PROBLEM_OPT,
     LABEL_X_OPT,
@@ -58,6 +72,14 @@ static const LongOpt LONG_OPTS[] = {
     {"iterations-max-num",		            ITERATIONS_MAX_NUM_OPT},
     {"w-results-num",			            W_RESULTS_NUM_OPT},
     {"chi-results-num",			            CHI_RESULTS_NUM_OPT},
+    {"grid-levels-num",                     GRID_LEVELS_NUM_OPT},
+    {"error-tolerance",                     ERROR_TOLERANCE_OPT},
+    {"field-error-tolerance",               FIELD_ERROR_TOLERANCE_OPT},
+    {"refinements-max-num",                 REFINEMENTS_MAX_NUM_OPT},
+    {"anderson-depth",                      ANDERSON_DEPTH_OPT},
+    {"coupling-anderson-depth",             COUPLING_ANDERSON_DEPTH_OPT},
+    {"relaxation-candidates-num",           RELAXATION_CANDIDATES_NUM_OPT},
+    {"chi-threads-num",                     CHI_THREADS_NUM_OPT},
     {"field-surf-splits-num",	            FIELD_SURFACE_SPLITS_NUM_OPT},
     {"field-int-splits-num",	            FIELD_INTERNAL_SPLITS_NUM_OPT},
     {"field-ext-splits-num",	            FIELD_EXTERNAL_SPLITS_NUM_OPT},
@@ -72,6 +94,12 @@ static const LongOpt LONG_OPTS[] = {
     {"equal-axis",				            EQUAL_AXIS_OPT},
     {"dimensionless",					    DIMENSIONLESS_OPT},
     {"pedantic-right-sweep",                PEDANTIC_RIGHT_SWEEP_OPT},
+    {"fluid-newton",                        FLUID_NEWTON_OPT},
+    {"fluid-spectral",                      FLUID_SPECTRAL_OPT},
+    {"inexact-coupling",                    INEXACT_COUPLING_OPT},
+    {"secant-predictor",                    SECANT_PREDICTOR_OPT},
+    {"arclength-continuation",              ARCLENGTH_CONTINUATION_OPT},
+    {"warm-start-chi",                      WARM_START_CHI_OPT},
     {"main-problem",                        MAIN_PROBLEM_OPT},
     {"field-model-problem",                 FIELD_MODEL_PROBLEM_OPT},
     {"label-x",                             LABEL_X_OPT},
@@ -120,9 +148,23 @@ ProgramOptsHandler::ProgramOptsHandler()
     mParams.fieldInfinityPosMultiplier = 4.0;
     mParams.resultsNumW = 1;
     mParams.resultsNumChi = 1;
+    mParams.gridLevelsNum = 1;
+    mParams.errorTolerance = 0.0;
+    mParams.fieldErrorTolerance = 0.0;
+    mParams.refinementsMaxNum = 3;
+    mParams.andersonDepth = 0;
+    mParams.couplingAndersonDepth = 0;
+    mParams.relaxationCandidatesNum = 1;
+    mParams.chiThreadsNum = 1;
     mParams.isEqualAxis = false;
     mParams.isDimensionless = false;
     mParams.isRightSweepPedantic = false;
+    mParams.isFluidNewtonEnabled = false;
+    mParams.isFluidSpectral = false;
+    mParams.isCouplingInexact = false;
+    mParams.isSecantPredictorEnabled = false;
+    mParams.isArclengthContinuation = false;
+    mParams.isWarmStartChi = false;
     mParams.isMainProblemEnabled = false;
     mParams.isFieldModelProblemEnabled = false;
     mParams.isPlotFluidSurfaceEnabled = false;
@@ -173,11 +215,23 @@ ProblemParams ProgramOptsHandler::problemParameters() const
     problemParams.fieldIterationsMaxNum = mParams.fieldIterationsMaxNum;
     problemParams.resultsNum = mParams.resultsNumW;
     problemParams.splitsNum = mParams.splitsNum;
+    problemParams.gridLevelsNum = mParams.gridLevelsNum;
+    problemParams.errorTolerance = mParams.errorTolerance;
+    problemParams.fieldErrorTolerance = mParams.fieldErrorTolerance;
+    problemParams.refinementsMaxNum = mParams.refinementsMaxNum;
+    problemParams.andersonDepth = mParams.andersonDepth;
+    problemParams.couplingAndersonDepth = mParams.couplingAndersonDepth;
+    problemParams.relaxationCandidatesNum = mParams.relaxationCandidatesNum;
     problemParams.gridParams.surfaceSplitsNum = mParams.fieldSurfaceSplitsNum;
     problemParams.gridParams.internalSplitsNum = mParams.fieldInternalSplitsNum;
     problemParams.gridParams.externalSplitsNum = mParams.fieldExternalSplitsNum;
     problemParams.gridParams.infMultiplier = mParams.fieldInfinityPosMultiplier;
     problemParams.isRightSweepPedantic = mParams.isRightSweepPedantic;
+    problemParams.isFluidNewtonEnabled = mParams.isFluidNewtonEnabled;
+    problemParams.isFluidSpectral = mParams.isFluidSpectral;
+    problemParams.isCouplingInexact = mParams.isCouplingInexact;
+    problemParams.isSecantPredictorEnabled = mParams.isSecantPredictorEnabled;
+    problemParams.isArclengthContinuation = mParams.isArclengthContinuation;
     problemParams.isDimensionless = mParams.isDimensionless;
 
     return problemParams;
@@ -200,7 +254,7 @@ PlotParams ProgramOptsHandler::plotParameters() const
 
 #pragma region Parse options
 
-void ProgramOptsHandler::parseOpts(int argsNum, char** args)
+void ProgramOptsHandler::parseOpts(int argsNum, char** args) noexcept(false)
 {
     int optId = 0;
     char* optPtr = nullptr;
@@ -228,6 +282,12 @@ void ProgramOptsHandler::parseOpts(int argsNum, char** args)
     {
         mParams.resultsNumChi = 1;
     }
+
+    // spectral fluid has its own iterations, Newton ones would be silently ignored
+    if (mParams.isFluidNewtonEnabled && mParams.isFluidSpectral)
+    {
+        throw std::runtime_error("Fluid Newton iterations cannot be combined with spectral fluid");
+    }
 }
 
 
@@ -283,6 +343,38 @@ void ProgramOptsHandler::handleOpt(int optId, char* optPtr)
             mParams.resultsNumChi = std::atoi(optPtr);
             break;
 
+        case GRID_LEVELS_NUM_OPT:
+            mParams.gridLevelsNum = std::atoi(optPtr);
+            break;
+
+        case ERROR_TOLERANCE_OPT:
+            mParams.errorTolerance = std::atof(optPtr);
+            break;
+
+        case FIELD_ERROR_TOLERANCE_OPT:
+            mParams.fieldErrorTolerance = std::atof(optPtr);
+            break;
+
+        case REFINEMENTS_MAX_NUM_OPT:
+            mParams.refinementsMaxNum = std::atoi(optPtr);
+            break;
+
+        case ANDERSON_DEPTH_OPT:
+            mParams.andersonDepth = std::atoi(optPtr);
+            break;
+
+        case COUPLING_ANDERSON_DEPTH_OPT:
+            mParams.couplingAndersonDepth = std::atoi(optPtr);
+            break;
+
+        case RELAXATION_CANDIDATES_NUM_OPT:
+            mParams.relaxationCandidatesNum = std::atoi(optPtr);
+            break;
+
+        case CHI_THREADS_NUM_OPT:
+            mParams.chiThreadsNum = std::atoi(optPtr);
+            break;
+
         case FIELD_SURFACE_SPLITS_NUM_OPT:
             mParams.fieldSurfaceSplitsNum = std::atoi(optPtr);
             break;
@@ -355,6 +447,30 @@ void ProgramOptsHandler::handleOpt(int optId, char* optPtr)
             mParams.isRightSweepPedantic = true;
             break;
 
+        case FLUID_NEWTON_OPT:
+            mParams.isFluidNewtonEnabled = true;
+            break;
+
+        case FLUID_SPECTRAL_OPT:
+            mParams.isFluidSpectral = true;
+            break;
+
+        case INEXACT_COUPLING_OPT:
+            mParams.isCouplingInexact = true;
+            break;
+
+        case SECANT_PREDICTOR_OPT:
+            mParams.isSecantPredictorEnabled = true;
+            break;
+
+        case ARCLENGTH_CONTINUATION_OPT:
+            mParams.isArclengthContinuation = true;
+            break;
+
+        case WARM_START_CHI_OPT:
+            mParams.isWarmStartChi = true;
+            break;
+
         case MAIN_PROBLEM_OPT:
             mParams.isMainProblemEnabled = true;
             break;
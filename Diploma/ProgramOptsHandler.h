@@ -24,6 +24,8 @@ typedef struct program_params_t
     double chiTarget;
     double fieldModelChi;
     double fieldInfinityPosMultiplier;
+    double errorTolerance;
+    double fieldErrorTolerance;
     int windowWidth;
     int windowHeight;
     int splitsNum;
@@ -34,9 +36,21 @@ typedef struct program_params_t
     int fieldIterationsMaxNum;
     int resultsNumW;
     int resultsNumChi;
+    int gridLevelsNum;
+    int refinementsMaxNum;
+    int andersonDepth;
+    int couplingAndersonDepth;
+    int relaxationCandidatesNum;
+    int chiThreadsNum;
     bool isEqualAxis;
     bool isDimensionless;
     bool isRightSweepPedantic;
+    bool isFluidNewtonEnabled;
+    bool isFluidSpectral;
+    bool isCouplingInexact;
+    bool isSecantPredictorEnabled;
+    bool isArclengthContinuation;
+    bool isWarmStartChi;
     bool isMainProblemEnabled;
     bool isFieldModelProblemEnabled;
     bool isPlotFluidSurfaceEnabled;
@@ -63,7 +77,7 @@ public:
     PlotParams plotParameters() const;
 
 
-    void parseOpts(int argsNum, char** args);
+    void parseOpts(int argsNum, char** args) noexcept(false);
 
 private:
     ProgramParams mParams;
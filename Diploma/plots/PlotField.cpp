@@ -12,24 +12,14 @@ PlotField::PlotField(const PlotParams& params) : mParams(params), mPipe("gnuplot
 
 #pragma region Member methods
 
-void PlotField::plot(const std::filesystem::path& fieldData, const std::filesystem::path& fluidData)
+void PlotField::plot(const std::filesystem::path& sampledFieldData, const std::filesystem::path& fluidData)
 {
-    const static Vector2<int> gridSize(60, 60);
-
-    FieldResultParams fieldParams = read_field_params(fieldData);
+    FieldResultParams fieldParams = read_field_params(sampledFieldData);
     FluidResultParams fluidParams = read_fluid_params(fluidData);
-    std::filesystem::path fieldGridData = intermediate_file_path("field-grid-data.dat");
 
     mPipe.write("set term wxt size %u,%u enhanced font 'Verdana,10'\n", mParams.windowWidth, mParams.windowHeight);
     mPipe.write("set datafile commentschars '%c'\n", COMMENT_CHARACTER);
-
-    mPipe.write("set table '%s'\n", fieldGridData.string().c_str());
-    mPipe.write("set dgrid3d %d,%d splines\n", gridSize.x, gridSize.y);
-
-    mPipe.write("splot '%s' using 1:2:3\n", fieldData.string().c_str());
-
-    mPipe.write("unset table\n");
-    mPipe.write("unset dgrid3d\n");
+    mPipe.write("set datafile missing NaN\n");
 
     mPipe.write("set pm3d map interpolate 6,6\n");
 
@@ -49,7 +39,7 @@ void PlotField::plot(const std::filesystem::path& fieldData, const std::filesyst
 
     mPipe.write("splot '%s' using 1:2:3 with pm3d notitle, "
                 "'%s' using 1:2:(0.0) with lines notitle ls @SURFACE_STYLE\n", 
-                fieldGridData.string().c_str(), 
+                sampledFieldData.string().c_str(), 
                 fluidData.string().c_str());
 
     mPipe.flush();
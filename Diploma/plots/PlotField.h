@@ -13,7 +13,7 @@ public:
     PlotField(const PlotParams& params);
 
     
-    void plot(const std::filesystem::path& fieldData, const std::filesystem::path& fluidData);
+    void plot(const std::filesystem::path& sampledFieldData, const std::filesystem::path& fluidData);
 
     void close();
 
@@ -21,11 +21,9 @@ PlotFieldIsolines::PlotFieldIsolines(const PlotParams& params) : mParams(params)
 
 #pragma region Member methods
 
-void PlotFieldIsolines::plot(const std::filesystem::path& fieldData, const std::filesystem::path& fluidData)
+void PlotFieldIsolines::plot(const std::filesystem::path& sampledFieldData, const std::filesystem::path& fluidData)
 {
-    const static Vector2<int> gridSize(60, 60);
-
-    FieldResultParams fieldParams = read_field_params(fieldData);
+    FieldResultParams fieldParams = read_field_params(sampledFieldData);
     FluidResultParams fluidParams = read_fluid_params(fluidData);
     std::filesystem::path contoursData = intermediate_file_path("field-contours.dat");
     std::string internalContours = generateInternalContours(fieldParams.potentialMin, fieldParams.fluidTopPotential);
@@ -34,9 +32,9 @@ void PlotFieldIsolines::plot(const std::filesystem::path& fieldData, const std::
 
     mPipe.write("set term wxt size %u,%u enhanced font 'Verdana,10'\n", mParams.windowWidth, mParams.windowHeight);
     mPipe.write("set datafile commentschars '%c'\n", COMMENT_CHARACTER);
+    mPipe.write("set datafile missing NaN\n");
 
     mPipe.write("set table '%s'\n", contoursData.string().c_str());
-    mPipe.write("set dgrid3d %d,%d splines\n", gridSize.x, gridSize.y);
     mPipe.write("set contour base\n");
     mPipe.write("set cntrparam linear\n");
     mPipe.write("set cntrparam levels discrete %s,%lf,%s\n", internalContours.c_str(),
@@ -45,10 +43,9 @@ void PlotFieldIsolines::plot(const std::filesystem::path& fieldData, const std::
     mPipe.write("set view map\n");
     mPipe.write("unset surface\n");
 
-    mPipe.write("splot '%s' using 1:2:3\n", fieldData.string().c_str());
+    mPipe.write("splot '%s' using 1:2:3\n", sampledFieldData.string().c_str());
 
     mPipe.write("unset table\n");
-    mPipe.write("unset dgrid3d\n");
     mPipe.write("unset contour\n");
 
     mPipe.write("load '%s'\n", plot_config_path("field-isolines.cfg").string().c_str());
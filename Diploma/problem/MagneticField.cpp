@@ -1,4 +1,5 @@
 #include "MagneticField.h"
+#include "console_util.h"
 #include "math_ext.h"
 
 
@@ -19,9 +20,14 @@ MagneticField::MagneticField(const MagneticParams& params) : mParams(params),
                                                              mLastValidValues(mGrid.rowsNum(), mGrid.columnsNum()), 
                                                              mCurApprox(mGrid.rowsNum(), mGrid.columnsNum()), 
                                                              mNextApprox(mGrid.rowsNum(), mGrid.columnsNum()), 
+                                                             mSavedGrid(params.gridParams), 
+                                                             mSavedValues(mGrid.rowsNum(), mGrid.columnsNum()), 
+                                                             mIsSavedGridDetached(false), 
+                                                             mIsSavedValuesDetached(false), 
                                                              mInnerDerivatives(mGrid.rowsNum()), 
                                                              mOuterDerivatives(mGrid.rowsNum()), 
                                                              mActions(), 
+                                                             mCancellationFlag(nullptr), 
                                                              mCurRelaxationParam(params.relaxParamInitial), 
                                                              mIterationsCounter(0U)
 {}
@@ -43,6 +49,18 @@ double MagneticField::currentChi() const
 }
 
 
+void MagneticField::setAccuracy(double accuracy)
+{
+    mParams.accuracy = accuracy;
+}
+
+
+double MagneticField::currentAccuracy() const
+{
+    return mParams.accuracy;
+}
+
+
 void MagneticField::setRelaxationParam(double param)
 {
     mCurRelaxationParam = param;
@@ -61,9 +79,31 @@ MagneticParams MagneticField::parameters() const
 }
 
 
+void MagneticField::setGridParams(const STGridParams& gridParams)
+{
+    mParams.gridParams = gridParams;
+    mGrid = SimpleTriangleGrid(gridParams);
+
+    mLastValidValues = Matrix<double>(mGrid.rowsNum(), mGrid.columnsNum());
+    mCurApprox = Matrix<double>(mGrid.rowsNum(), mGrid.columnsNum());
+    mNextApprox = Matrix<double>(mGrid.rowsNum(), mGrid.columnsNum());
+    mInnerDerivatives = Array<Vector2<double>>(mGrid.rowsNum());
+    mOuterDerivatives = Array<Vector2<double>>(mGrid.rowsNum());
+
+    mSavedGrid = SimpleTriangleGrid(gridParams);
+    mSavedValues = Matrix<double>(mGrid.rowsNum(), mGrid.columnsNum());
+    mIsSavedGridDetached = false;
+    mIsSavedValuesDetached = false;
+}
+
+
 void MagneticField::setGrid(const SimpleTriangleGrid& grid)
 {
-    mGrid = grid;
+    if (&grid != &mGrid)
+    {
+        detachSavedGrid();
+        mGrid = grid;
+    }
 }
 
 
@@ -75,7 +115,46 @@ const SimpleTriangleGrid& MagneticField::grid() const
 
 void MagneticField::setLastValidResult(const Matrix<double>& values)
 {
-    mLastValidValues = values;
+    if (&values != &mLastValidValues)
+    {
+        detachSavedValues();
+        mLastValidValues = values;
+    }
+}
+
+
+void MagneticField::setResampledResult(const Matrix<double>& values, const STGridParams& valuesGridParams)
+{
+    arr_size_t gridRowsNum = mGrid.rowsNum();
+    arr_size_t gridColumnsNum = mGrid.columnsNum();
+    arr_size_t surfaceColumnIndex = mGrid.surfaceColumnsIndex();
+    arr_size_t externalSplitsNum = gridColumnsNum - 1 - surfaceColumnIndex;
+    double valuesMaxColumnIndex = (double)(values.columnsNum() - 1);
+    double rowParam = 0.0;
+    double columnPos = 0.0;
+
+    detachSavedValues();
+
+    for (arr_size_t i = 0; i < gridRowsNum; i++)
+    {
+        rowParam = (double)i / (gridRowsNum - 1);
+
+        for (arr_size_t j = 0; j < gridColumnsNum; j++)
+        {
+            // internal and external blocks are mapped separately so the surface column always matches
+            if (j <= surfaceColumnIndex)
+            {
+                columnPos = (double)j / surfaceColumnIndex * valuesGridParams.internalSplitsNum;
+            }
+            else
+            {
+                columnPos = valuesGridParams.internalSplitsNum + 
+                            (double)(j - surfaceColumnIndex) / externalSplitsNum * valuesGridParams.externalSplitsNum;
+            }
+
+            mLastValidValues(i, j) = parametric_point(values, rowParam, columnPos / valuesMaxColumnIndex);
+        }
+    }
 }
 
 
@@ -85,6 +164,41 @@ const Matrix<double>& MagneticField::lastValidResult() const
 }
 
 
+void MagneticField::saveResult()
+{
+    mIsSavedGridDetached = false;
+    mIsSavedValuesDetached = false;
+}
+
+
+void MagneticField::restoreResult()
+{
+    if (mIsSavedGridDetached)
+    {
+        mGrid.swap(mSavedGrid);
+        mIsSavedGridDetached = false;
+    }
+
+    if (mIsSavedValuesDetached)
+    {
+        mLastValidValues.swap(mSavedValues);
+        mIsSavedValuesDetached = false;
+    }
+}
+
+
+const SimpleTriangleGrid& MagneticField::savedGrid() const
+{
+    return mIsSavedGridDetached ? mSavedGrid : mGrid;
+}
+
+
+const Matrix<double>& MagneticField::savedResult() const
+{
+    return mIsSavedValuesDetached ? mSavedValues : mLastValidValues;
+}
+
+
 const Array<Vector2<double>>& MagneticField::innerDerivatives() const
 {
     return mInnerDerivatives;
@@ -102,6 +216,12 @@ void MagneticField::resetIterationsCounter()
     mIterationsCounter = 0U;
 }
 
+
+void MagneticField::setCancellationFlag(const std::atomic<bool>* flag)
+{
+    mCancellationFlag = flag;
+}
+
 #pragma endregion
 
 
@@ -134,6 +254,8 @@ void MagneticField::runActions() const
 
 void MagneticField::updateGrid(const Array<Vector2<double>>& surfacePoints)
 {
+    // grid is generated anew, so the detached buffer is not copied
+    detachSavedGrid();
     mGrid.generate(surfacePoints);
 }
 
@@ -276,7 +398,9 @@ void MagneticField::calcInitialApproximation()
     arr_size_t gridRowsNum = mGrid.rowsNum();
     arr_size_t gridColumnsNum = mGrid.columnsNum();
 
-    printf("Calculating field initial approximation...\n");
+    print_message("Calculating field initial approximation...\n");
+
+    detachSavedValues();
 
     for (arr_size_t i = 0; i < gridRowsNum; i++)
     {
@@ -286,7 +410,7 @@ void MagneticField::calcInitialApproximation()
         }
     }
 
-    printf("Field initial approximation calculated\n\n");
+    print_message("Field initial approximation calculated\n\n");
 }
 
 
@@ -364,7 +488,7 @@ ResultCode MagneticField::calcRelaxation()
     arr_size_t gridColumnsNum = mGrid.columnsNum();
     arr_size_t limitColumns = gridColumnsNum - 1;
 
-    printf("Calculating field relaxation...\n");
+    print_message("Calculating field relaxation...\n");
 
     for (arr_size_t i = 0; i < gridRowsNum; i++)
     {
@@ -391,28 +515,34 @@ ResultCode MagneticField::calcRelaxation()
         counter++;
 
         runActions();
-    } while (norm(mNextApprox, mCurApprox) > curEpsilon);
+    } while (norm(mNextApprox, mCurApprox) > curEpsilon && !isCancelled());
 
     mIterationsCounter += counter;
 
-    if (counter >= mParams.iterationsNumMax)
+    if (isCancelled())
     {
-        printf("Field relaxation iterations limit exceeded\n\n");
+        print_message("Field relaxation cancelled\n\n");
+        return ResultCode::FIELD_CANCELLED;
+    }
+    else if (counter >= mParams.iterationsNumMax)
+    {
+        print_message("Field relaxation iterations limit exceeded\n\n");
         return ResultCode::FIELD_ITERATIONS_LIMIT_EXCEEDED;
     }
     else if (!isApproximationValid(mNextApprox))
     {
-        printf("Field relaxation invalid result\n\n");
+        print_message("Field relaxation invalid result\n\n");
         return ResultCode::FIELD_INVALID_RESULT;
     }
     else
     {
+        detachSavedValues();
         mLastValidValues.swap(mNextApprox);
 
         calcDerivatives();
     }
 
-    printf("Field relaxation calculated\n\n");
+    print_message("Field relaxation calculated\n\n");
 
     return ResultCode::FIELD_SUCCESS;
 }
@@ -420,6 +550,32 @@ ResultCode MagneticField::calcRelaxation()
 #pragma endregion
 
 
+#pragma region Saved result
+
+// Saved buffers take the current ones before they are overwritten, the buffer left in place
+// holds an outdated state and is expected to be overwritten entirely
+void MagneticField::detachSavedGrid()
+{
+    if (!mIsSavedGridDetached)
+    {
+        mGrid.swap(mSavedGrid);
+        mIsSavedGridDetached = true;
+    }
+}
+
+
+void MagneticField::detachSavedValues()
+{
+    if (!mIsSavedValuesDetached)
+    {
+        mLastValidValues.swap(mSavedValues);
+        mIsSavedValuesDetached = true;
+    }
+}
+
+#pragma endregion
+
+
 #pragma region Validation
 
 bool MagneticField::isApproximationValid(const Matrix<double>& approx) const
@@ -448,6 +604,12 @@ bool MagneticField::isIndicesValid(const Vector2<arr_size_t>& indices) const
            indices.i < mGrid.rowsNum() && indices.j < mGrid.columnsNum();
 }
 
+
+bool MagneticField::isCancelled() const
+{
+    return mCancellationFlag != nullptr && mCancellationFlag->load();
+}
+
 #pragma endregion
 
 
@@ -567,3 +729,104 @@ void MagneticField::calcDerivatives()
 }
 
 #pragma endregion
+
+
+#pragma region Error estimation
+
+Vector2<double> MagneticField::calcFlux(const Vector2<arr_size_t>& vert1Indices, 
+                                        const Vector2<arr_size_t>& vert2Indices, 
+                                        const Vector2<arr_size_t>& vert3Indices) const
+{
+    arr_size_t surfaceColumnIndex = mGrid.surfaceColumnsIndex();
+
+    Vector2<double> vert1 = mGrid(vert1Indices);
+    Vector2<double> vert2 = mGrid(vert2Indices);
+    Vector2<double> vert3 = mGrid(vert3Indices);
+
+    double value1 = mLastValidValues(vert1Indices);
+    double value2 = mLastValidValues(vert2Indices);
+    double value3 = mLastValidValues(vert3Indices);
+
+    double doubleArea = double_triangle_area(vert1, vert2, vert3);
+
+    if (doubleArea == 0.0)
+    {
+        return { 0.0, 0.0 };
+    }
+
+    double chi = (vert1Indices.j > surfaceColumnIndex || 
+                  vert2Indices.j > surfaceColumnIndex || 
+                  vert3Indices.j > surfaceColumnIndex) ? 0.0 : mParams.chi;
+
+    Vector2<double> gradient(double_triangle_area({ value1, vert1.z }, { value2, vert2.z }, { value3, vert3.z }) / doubleArea,
+                             double_triangle_area({ vert1.r, value1 }, { vert2.r, value2 }, { vert3.r, value3 }) / doubleArea);
+
+    return (1.0 + chi) * gradient;
+}
+
+
+double MagneticField::calcFluxJump(const Vector2<double>& flux1, 
+                                   const Vector2<double>& flux2, 
+                                   const Vector2<arr_size_t>& edgeStart, 
+                                   const Vector2<arr_size_t>& edgeEnd) const
+{
+    Vector2<double> edge = mGrid(edgeEnd) - mGrid(edgeStart);
+    Vector2<double> jump = flux1 - flux2;
+
+    // normal flux jump scaled by edge length, (edge.z, -edge.r) is the edge normal of the same length
+    return std::abs(jump.r * edge.z - jump.z * edge.r);
+}
+
+
+FieldErrorEstimate MagneticField::estimateError() const
+{
+    FieldErrorEstimate result = { 0.0, 0.0, 0.0 };
+    arr_size_t cellRowsNum = mGrid.rowsNum() - 1;
+    arr_size_t cellColumnsNum = mGrid.columnsNum() - 1;
+    arr_size_t surfaceColumnIndex = mGrid.surfaceColumnsIndex();
+    double jump = 0.0;
+
+    // every cell (i, j) holds triangles {(i, j), (i, j + 1), (i + 1, j)} and {(i + 1, j), (i, j + 1), (i + 1, j + 1)},
+    // jumps across edges between rows show lack of surface splits, across edges between columns - of column splits
+    for (arr_size_t i = 0; i < cellRowsNum; i++)
+    {
+        for (arr_size_t j = 0; j < cellColumnsNum; j++)
+        {
+            double& columnEstimate = (j + 1 <= surfaceColumnIndex) ? result.internal : result.external;
+
+            Vector2<double> lowerFlux = calcFlux({ i, j }, { i, j + 1 }, { i + 1, j });
+            Vector2<double> upperFlux = calcFlux({ i + 1, j }, { i, j + 1 }, { i + 1, j + 1 });
+
+            jump = calcFluxJump(lowerFlux, upperFlux, { i, j + 1 }, { i + 1, j });
+            result.surface = std::max(result.surface, jump);
+            columnEstimate = std::max(columnEstimate, jump);
+
+            if (j + 1 < cellColumnsNum)
+            {
+                jump = calcFluxJump(upperFlux, calcFlux({ i, j + 1 }, { i, j + 2 }, { i + 1, j + 1 }), 
+                                    { i, j + 1 }, { i + 1, j + 1 });
+
+                if (j + 1 <= surfaceColumnIndex)
+                {
+                    result.internal = std::max(result.internal, jump);
+                }
+
+                if (j + 1 >= surfaceColumnIndex)
+                {
+                    result.external = std::max(result.external, jump);
+                }
+            }
+
+            if (i + 1 < cellRowsNum)
+            {
+                jump = calcFluxJump(upperFlux, calcFlux({ i + 1, j }, { i + 1, j + 1 }, { i + 2, j }), 
+                                    { i + 1, j }, { i + 1, j + 1 });
+                result.surface = std::max(result.surface, jump);
+            }
+        }
+    }
+
+    return result;
+}
+
+#pragma endregion
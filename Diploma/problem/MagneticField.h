@@ -5,6 +5,7 @@
     #define SIGNED_ARR_SIZE
 #endif
 
+#include <atomic>
 #include <functional>
 #include <unordered_map>
 #include "SimpleTriangleGrid.h"
@@ -21,6 +22,13 @@ typedef struct magnetic_params_t
     int iterationsNumMax;
 } MagneticParams;
 
+typedef struct field_error_estimate_t
+{
+    double surface;
+    double internal;
+    double external;
+} FieldErrorEstimate;
+
 typedef std::function<void(const MagneticParams& params, 
                            const Matrix<double>& nextApprox, 
                            const Matrix<double>& curApprox, 
@@ -37,26 +45,44 @@ public:
 
     double currentChi() const;
 
+    void setAccuracy(double accuracy);
+
+    double currentAccuracy() const;
+
     void setRelaxationParam(double param);
 
     double currentRelaxationParam() const;
 
     MagneticParams parameters() const;
 
+    void setGridParams(const STGridParams& gridParams);
+
     void setGrid(const SimpleTriangleGrid& grid);
 
     const SimpleTriangleGrid& grid() const;
 
     void setLastValidResult(const Matrix<double>& values);
 
+    void setResampledResult(const Matrix<double>& values, const STGridParams& valuesGridParams);
+
     const Matrix<double>& lastValidResult() const;
 
+    void saveResult();
+
+    void restoreResult();
+
+    const SimpleTriangleGrid& savedGrid() const;
+
+    const Matrix<double>& savedResult() const;
+
     const Array<Vector2<double>>& innerDerivatives() const;
 
     const Array<Vector2<double>>& outerDerivatives() const;
 
     void resetIterationsCounter();
 
+    void setCancellationFlag(const std::atomic<bool>* flag);
+
 
     void setActionForKey(const std::string& key, const MagneticFieldAction& action);
 
@@ -71,6 +97,9 @@ public:
 	Vector2<double> calcOuterDerivative(double param) const;
 
 
+    FieldErrorEstimate estimateError() const;
+
+
     void updateGrid(const Array<Vector2<double>>& surfacePoints);
 
 
@@ -85,11 +114,20 @@ private:
 	Matrix<double> mCurApprox;
 	Matrix<double> mNextApprox;
 
+    // saved grid and values are shared with the current ones until those are overwritten, 
+    // they are swapped out then, so that both saving and restoring take constant time
+    SimpleTriangleGrid mSavedGrid;
+    Matrix<double> mSavedValues;
+    bool mIsSavedGridDetached;
+    bool mIsSavedValuesDetached;
+
 	Array<Vector2<double>> mInnerDerivatives;
 	Array<Vector2<double>> mOuterDerivatives;
 
     std::unordered_map<std::string, MagneticFieldAction> mActions;
 
+    const std::atomic<bool>* mCancellationFlag;
+
 	double mCurRelaxationParam;
 
 	unsigned int mIterationsCounter;
@@ -112,13 +150,30 @@ private:
 	void calcNextApproximation();
 
 
+    void detachSavedGrid();
+
+    void detachSavedValues();
+
+
     void calcDerivatives();
 
 
+    Vector2<double> calcFlux(const Vector2<arr_size_t>& vert1Indices, 
+                             const Vector2<arr_size_t>& vert2Indices, 
+                             const Vector2<arr_size_t>& vert3Indices) const;
+
+    double calcFluxJump(const Vector2<double>& flux1, 
+                        const Vector2<double>& flux2, 
+                        const Vector2<arr_size_t>& edgeStart, 
+                        const Vector2<arr_size_t>& edgeEnd) const;
+
+
 	bool isApproximationValid(const Matrix<double>& approx) const;
 
 	bool isIndicesValid(const Vector2<arr_size_t>& indices) const;
 
+    bool isCancelled() const;
+
 
     void runActions() const;
 };
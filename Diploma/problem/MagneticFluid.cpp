@@ -1,24 +1,63 @@
 #include "MagneticFluid.h"
+#include "console_util.h"
 #include "math_ext.h"
 #include <algorithm>
 
 
+static const double NEWTON_DIFFERENCE_STEP = 1.5e-8;
+
+// accelerated iterations restart from plain relaxation when the fixed-point residual grows by this factor
+static const double ANDERSON_SAFEGUARD_GROWTH = 1.0;
+
+
+static arr_size_t spectral_points_num(const FluidParams& params)
+{
+    // collocation storage is dense, finite difference mode keeps only a stub of it
+    return params.isSpectral ? params.splitsNum + 1 : 2;
+}
+
+
 #pragma region Constructors
 
 MagneticFluid::MagneticFluid(const FluidParams& params) : mParams(params), 
                                                           mPointsNum(params.splitsNum + 1), 
-                                                          mRightSweep(mPointsNum, params.isRightSweepPedantic), 
+                                                          mRightSweepR(mPointsNum, params.isRightSweepPedantic), 
+                                                          mRightSweepZ(mPointsNum, params.isRightSweepPedantic), 
+                                                          mNewtonSweep(mPointsNum, params.isRightSweepPedantic), 
+                                                          mCollocation(spectral_points_num(params)), 
+                                                          mSpectralSolverR(spectral_points_num(params), params.isRightSweepPedantic), 
+                                                          mSpectralSolverZ(spectral_points_num(params), params.isRightSweepPedantic), 
+                                                          mAnderson(2 * mPointsNum, params.andersonDepth), 
                                                           mLastValidResult(mPointsNum), 
-                                                          mDerivatives(mPointsNum), 
+                                                          mSavedResult(mPointsNum), 
+                                                          mIsSavedResultDetached(false), 
+                                                          mDerivativesR(mPointsNum), 
+                                                          mDerivativesZ(mPointsNum), 
+                                                          mMagneticF(mPointsNum), 
+                                                          mDifR(mPointsNum), 
+                                                          mDifZ(mPointsNum), 
                                                           mNextApproxR(mPointsNum), 
                                                           mNextApproxZ(mPointsNum), 
                                                           mCurApproxR(mPointsNum), 
                                                           mCurApproxZ(mPointsNum), 
+                                                          mStackedCurApprox(2 * mPointsNum), 
+                                                          mStackedNextApprox(2 * mPointsNum), 
+                                                          mPrevApproxDif(0.0), 
                                                           mActions(), 
                                                           mStep(1.0 / params.splitsNum), 
                                                           mCurRelaxationParam(params.relaxParamInitial), 
-                                                          mIterationsCounter(0U)
-{}
+                                                          mIterationsCounter(0U), 
+                                                          mCancellationFlag(nullptr)
+{
+    if (mParams.isSpectral)
+    {
+        calcSpectralMatrixR();
+    }
+    else
+    {
+        calcMatrixR();
+    }
+}
 
 #pragma endregion
 
@@ -61,6 +100,18 @@ double MagneticFluid::currentChi() const
 }
 
 
+void MagneticFluid::setEpsilon(double epsilon)
+{
+    mParams.epsilon = epsilon;
+}
+
+
+double MagneticFluid::currentEpsilon() const
+{
+    return mParams.epsilon;
+}
+
+
 FluidParams MagneticFluid::parameters() const
 {
     return mParams;
@@ -73,9 +124,68 @@ arr_size_t MagneticFluid::pointsNum() const
 }
 
 
+void MagneticFluid::setSplitsNum(int splitsNum)
+{
+    mParams.splitsNum = splitsNum;
+    mPointsNum = splitsNum + 1;
+    mStep = 1.0 / splitsNum;
+
+    mRightSweepR = RightSweep(mPointsNum, mParams.isRightSweepPedantic);
+    mRightSweepZ = RightSweep(mPointsNum, mParams.isRightSweepPedantic);
+    mNewtonSweep = BlockRightSweep(mPointsNum, mParams.isRightSweepPedantic);
+    mCollocation = ChebyshevCollocation(spectral_points_num(mParams));
+    mSpectralSolverR = DenseLUSolver(spectral_points_num(mParams), mParams.isRightSweepPedantic);
+    mSpectralSolverZ = DenseLUSolver(spectral_points_num(mParams), mParams.isRightSweepPedantic);
+    mAnderson = AndersonAcceleration(2 * mPointsNum, mParams.andersonDepth);
+
+    mLastValidResult = Array<Vector2<double>>(mPointsNum);
+    mSavedResult = Array<Vector2<double>>(mPointsNum);
+    mIsSavedResultDetached = false;
+    mDerivativesR = Array<double>(mPointsNum);
+    mDerivativesZ = Array<double>(mPointsNum);
+    mMagneticF = Array<double>(mPointsNum);
+    mDifR = Array<double>(mPointsNum);
+    mDifZ = Array<double>(mPointsNum);
+    mNextApproxR = Array<double>(mPointsNum);
+    mNextApproxZ = Array<double>(mPointsNum);
+    mCurApproxR = Array<double>(mPointsNum);
+    mCurApproxZ = Array<double>(mPointsNum);
+    mStackedCurApprox = Array<double>(2 * mPointsNum);
+    mStackedNextApprox = Array<double>(2 * mPointsNum);
+
+    if (mParams.isSpectral)
+    {
+        calcSpectralMatrixR();
+    }
+    else
+    {
+        calcMatrixR();
+    }
+}
+
+
 void MagneticFluid::setLastValidResult(const Array<Vector2<double>>& values)
 {
-    mLastValidResult = values;
+    if (&values != &mLastValidResult)
+    {
+        detachSavedResult();
+        mLastValidResult = values;
+    }
+}
+
+
+void MagneticFluid::setResampledResult(const Array<Vector2<double>>& values)
+{
+    arr_size_t limit = mPointsNum - 1;
+
+    detachSavedResult();
+
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        // spectral surfaces are resampled by their interpolating polynomial, other ones piecewise linearly
+        mLastValidResult(i) = mParams.isSpectral ? ChebyshevCollocation::interpolate(values, mCollocation.node(i)) : 
+                                                   parametric_point(values, (double)i / limit);
+    }
 }
 
 
@@ -85,14 +195,47 @@ const Array<Vector2<double>>& MagneticFluid::lastValidResult() const
 }
 
 
+void MagneticFluid::saveResult()
+{
+    mIsSavedResultDetached = false;
+}
+
+
+void MagneticFluid::restoreResult()
+{
+    if (mIsSavedResultDetached)
+    {
+        mLastValidResult.swap(mSavedResult);
+        mIsSavedResultDetached = false;
+    }
+}
+
+
+const Array<Vector2<double>>& MagneticFluid::savedResult() const
+{
+    return mIsSavedResultDetached ? mSavedResult : mLastValidResult;
+}
+
+
 void MagneticFluid::setDerivatives(const Array<Vector2<double>>& values)
 {
-    mDerivatives = values;
+    assert_message(values.size() == mPointsNum, "Fluid derivatives size differs from the fluid points number");
+
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        mDerivativesR(i) = values(i).r;
+        mDerivativesZ(i) = values(i).z;
+    }
 }
 
 
 double MagneticFluid::volumeNondimMul() const
 {
+    if (mParams.isSpectral)
+    {
+        return 1.0 / cbrt(calcIntegralSpectral(mLastValidResult));
+    }
+
     return 1.0 / cbrt(calcIntegralTrapeze(mLastValidResult));
 }
 
@@ -108,6 +251,12 @@ void MagneticFluid::resetIterationsCounter()
     mIterationsCounter = 0U;
 }
 
+
+void MagneticFluid::setCancellationFlag(const std::atomic<bool>* flag)
+{
+    mCancellationFlag = flag;
+}
+
 #pragma endregion
 
 
@@ -140,23 +289,43 @@ void MagneticFluid::runActions() const
 
 void MagneticFluid::calcInitialApproximation()
 {
-    printf("Calculating fluid initial approximation...\n");
+    print_message("Calculating fluid initial approximation...\n");
+
+    detachSavedResult();
 
     for (arr_size_t i = 0; i < mPointsNum; i++)
     {
-        mLastValidResult(i) = { M_2_PI * sin(M_PI_2 * i * mStep), M_2_PI * cos(M_PI_2 * i * mStep) };
+        double arcLength = mParams.isSpectral ? mCollocation.node(i) : i * mStep;
+
+        mLastValidResult(i) = { M_2_PI * sin(M_PI_2 * arcLength), M_2_PI * cos(M_PI_2 * arcLength) };
     }
 
-    printf("Fluid initial approximation calculated\n\n");
+    print_message("Fluid initial approximation calculated\n\n");
 }
 
 
 ResultCode MagneticFluid::calcRelaxation()
+{
+    if (mParams.isSpectral)
+    {
+        return calcSpectralRelaxation();
+    }
+
+    if (mParams.isNewtonEnabled)
+    {
+        return calcNewtonRelaxation();
+    }
+
+    return calcFixedPointRelaxation();
+}
+
+
+ResultCode MagneticFluid::calcFixedPointRelaxation()
 {
     double curEpsilon = mParams.epsilon * mCurRelaxationParam;
     int counter = 0;
 
-    printf("Calculating fluid relaxation...\n");
+    print_message("Calculating fluid relaxation...\n");
 
     for (arr_size_t i = 0; i < mPointsNum; i++)
     {
@@ -164,37 +333,249 @@ ResultCode MagneticFluid::calcRelaxation()
         mNextApproxZ(i) = mLastValidResult(i).z;
     }
 
+    mAnderson.reset();
+    mPrevApproxDif = std::numeric_limits<double>::max();
+
     do
     {
         mNextApproxR.swap(mCurApproxR);
         mNextApproxZ.swap(mCurApproxZ);
 
-        calcNextApproximationR(mCurApproxZ, mCurApproxZ);
+        // both half-steps take integrals over the current approximation, so they are shared
+        FluidIntegrals integrals = calcIntegrals(mCurApproxR, mCurApproxZ);
+
+        calcNextApproximationR(mCurApproxZ, integrals);
         relaxation(mNextApproxR, mCurApproxR, mCurRelaxationParam);
 
-        calcNextApproximationZ(mNextApproxR, mCurApproxR);
+        calcNextApproximationZ(mNextApproxR, mCurApproxR, integrals);
         relaxation(mNextApproxZ, mCurApproxZ, mCurRelaxationParam);
 
+        if (mAnderson.depth() > 0)
+        {
+            calcAcceleratedApproximation(std::max(norm(mNextApproxR, mCurApproxR), norm(mNextApproxZ, mCurApproxZ)));
+        }
+
         counter++;
 
         runActions();
-    } while (std::max(norm(mNextApproxR, mCurApproxR), norm(mNextApproxZ, mNextApproxZ)) > curEpsilon &&
-             counter < mParams.iterationsNumMax);
+    } while (std::max(norm(mNextApproxR, mCurApproxR), norm(mNextApproxZ, mCurApproxZ)) > curEpsilon &&
+             counter < mParams.iterationsNumMax && !isCancelled());
+
+    return finishRelaxation(counter);
+}
+
+
+void MagneticFluid::calcAcceleratedApproximation(double approxDif)
+{
+    // history is dropped when plain iteration would have been better, the relaxed step is taken then
+    if (approxDif > ANDERSON_SAFEGUARD_GROWTH * mPrevApproxDif)
+    {
+        mAnderson.reset();
+    }
 
+    mPrevApproxDif = approxDif;
+
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        mStackedCurApprox(i) = mCurApproxR(i);
+        mStackedCurApprox(mPointsNum + i) = mCurApproxZ(i);
+        mStackedNextApprox(i) = mNextApproxR(i);
+        mStackedNextApprox(mPointsNum + i) = mNextApproxZ(i);
+    }
+
+    mAnderson.calcNextApproximation(mStackedCurApprox, mStackedNextApprox, mStackedNextApprox);
+
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        if (!std::isfinite(mStackedNextApprox(i)) || mStackedNextApprox(i) < 0.0 || 
+            !std::isfinite(mStackedNextApprox(mPointsNum + i)) || mStackedNextApprox(mPointsNum + i) < 0.0)
+        {
+            mAnderson.reset();
+            return;
+        }
+    }
+
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        mNextApproxR(i) = mStackedNextApprox(i);
+        mNextApproxZ(i) = mStackedNextApprox(mPointsNum + i);
+    }
+}
+
+
+ResultCode MagneticFluid::calcNewtonRelaxation()
+{
+    double curEpsilon = mParams.epsilon * mCurRelaxationParam;
+    int counter = 0;
+    double* constTerms = nullptr;
+    Array<Vector2<double>> residual(mPointsNum);
+    Array<Vector2<double>> step(mPointsNum);
+    Array<Vector2<double>> multiplierResponse(mPointsNum);
+    Array<Vector2<double>> valQResponse(mPointsNum);
+    Array<Vector2<double>> multiplierGradient(mPointsNum);
+    Array<Vector2<double>> valQGradient(mPointsNum);
+
+    print_message("Calculating fluid Newton relaxation...\n");
+
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        mNextApproxR(i) = mLastValidResult(i).r;
+        mNextApproxZ(i) = mLastValidResult(i).z;
+    }
+
+    do
+    {
+        mNextApproxR.swap(mCurApproxR);
+        mNextApproxZ.swap(mCurApproxZ);
+
+        FluidIntegrals integrals = calcIntegrals(mCurApproxR, mCurApproxZ);
+
+        calcResidual(mCurApproxR, mCurApproxZ, integrals.magneticMultiplier, integrals.valQ, residual);
+        calcJacobian(mCurApproxR, mCurApproxZ, integrals, residual);
+
+        // residual is linear in the magnetic multiplier and Q, so unit increments give exact responses
+        calcResidual(mCurApproxR, mCurApproxZ, integrals.magneticMultiplier + 1.0, integrals.valQ, multiplierResponse);
+        calcResidual(mCurApproxR, mCurApproxZ, integrals.magneticMultiplier, integrals.valQ + 1.0, valQResponse);
+        calcIntegralsGradients(mCurApproxR, mCurApproxZ, integrals, multiplierGradient, valQGradient);
+
+        multiplierResponse -= residual;
+        valQResponse -= residual;
+
+        // Jacobian is block tridiagonal part plus rank 2 border from the volume and magnetic integrals,
+        // border is eliminated with Sherman-Morrison-Woodbury formula using three block sweeps
+        constTerms = mNewtonSweep.diagonal(RS_CONST_TERMS);
+
+        for (arr_size_t i = 0; i < mPointsNum; i++)
+        {
+            constTerms[2 * i] = -residual(i).r;
+            constTerms[2 * i + 1] = -residual(i).z;
+        }
+
+        mNewtonSweep.solve(step);
+
+        for (arr_size_t i = 0; i < mPointsNum; i++)
+        {
+            constTerms[2 * i] = multiplierResponse(i).r;
+            constTerms[2 * i + 1] = multiplierResponse(i).z;
+        }
+
+        mNewtonSweep.solve(multiplierResponse);
+
+        for (arr_size_t i = 0; i < mPointsNum; i++)
+        {
+            constTerms[2 * i] = valQResponse(i).r;
+            constTerms[2 * i + 1] = valQResponse(i).z;
+        }
+
+        mNewtonSweep.solve(valQResponse);
+
+        double border11 = 1.0;
+        double border12 = 0.0;
+        double border21 = 0.0;
+        double border22 = 1.0;
+        double borderTerm1 = 0.0;
+        double borderTerm2 = 0.0;
+
+        for (arr_size_t i = 0; i < mPointsNum; i++)
+        {
+            border11 += multiplierGradient(i).r * multiplierResponse(i).r + multiplierGradient(i).z * multiplierResponse(i).z;
+            border12 += multiplierGradient(i).r * valQResponse(i).r + multiplierGradient(i).z * valQResponse(i).z;
+            border21 += valQGradient(i).r * multiplierResponse(i).r + valQGradient(i).z * multiplierResponse(i).z;
+            border22 += valQGradient(i).r * valQResponse(i).r + valQGradient(i).z * valQResponse(i).z;
+            borderTerm1 += multiplierGradient(i).r * step(i).r + multiplierGradient(i).z * step(i).z;
+            borderTerm2 += valQGradient(i).r * step(i).r + valQGradient(i).z * step(i).z;
+        }
+
+        double invDet = 1.0 / (border11 * border22 - border12 * border21);
+        double multiplierCoef = (border22 * borderTerm1 - border12 * borderTerm2) * invDet;
+        double valQCoef = (border11 * borderTerm2 - border21 * borderTerm1) * invDet;
+
+        // relaxation parameter damps Newton step, so relaxation halving in Solution keeps working
+        for (arr_size_t i = 0; i < mPointsNum; i++)
+        {
+            Vector2<double> correction = step(i) - multiplierCoef * multiplierResponse(i) - valQCoef * valQResponse(i);
+
+            mNextApproxR(i) = mCurApproxR(i) + mCurRelaxationParam * correction.r;
+            mNextApproxZ(i) = mCurApproxZ(i) + mCurRelaxationParam * correction.z;
+        }
+
+        counter++;
+
+        runActions();
+    } while (std::max(norm(mNextApproxR, mCurApproxR), norm(mNextApproxZ, mCurApproxZ)) > curEpsilon &&
+             counter < mParams.iterationsNumMax && !isCancelled());
+
+    return finishRelaxation(counter);
+}
+
+
+ResultCode MagneticFluid::calcSpectralRelaxation()
+{
+    double curEpsilon = mParams.epsilon * mCurRelaxationParam;
+    int counter = 0;
+
+    print_message("Calculating fluid relaxation...\n");
+
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        mNextApproxR(i) = mLastValidResult(i).r;
+        mNextApproxZ(i) = mLastValidResult(i).z;
+    }
+
+    mAnderson.reset();
+    mPrevApproxDif = std::numeric_limits<double>::max();
+
+    do
+    {
+        mNextApproxR.swap(mCurApproxR);
+        mNextApproxZ.swap(mCurApproxZ);
+
+        FluidIntegrals integrals = calcSpectralIntegrals(mCurApproxR, mCurApproxZ);
+
+        calcSpectralApproximationR(mDifZ, integrals);
+        relaxation(mNextApproxR, mCurApproxR, mCurRelaxationParam);
+
+        calcSpectralApproximationZ(mNextApproxR, integrals);
+        relaxation(mNextApproxZ, mCurApproxZ, mCurRelaxationParam);
+
+        if (mAnderson.depth() > 0)
+        {
+            calcAcceleratedApproximation(std::max(norm(mNextApproxR, mCurApproxR), norm(mNextApproxZ, mCurApproxZ)));
+        }
+
+        counter++;
+
+        runActions();
+    } while (std::max(norm(mNextApproxR, mCurApproxR), norm(mNextApproxZ, mCurApproxZ)) > curEpsilon &&
+             counter < mParams.iterationsNumMax && !isCancelled());
+
+    return finishRelaxation(counter);
+}
+
+
+ResultCode MagneticFluid::finishRelaxation(int counter)
+{
     mIterationsCounter += counter;
 
-    if (counter >= mParams.iterationsNumMax)
+    if (isCancelled())
+    {
+        print_message("Fluid relaxation cancelled\n\n");
+        return ResultCode::FLUID_CANCELLED;
+    }
+    else if (counter >= mParams.iterationsNumMax)
     {
-        printf("Fluid relaxation iterations limit exceeded\n\n");
+        print_message("Fluid relaxation iterations limit exceeded\n\n");
         return ResultCode::FLUID_ITERATIONS_LIMIT_EXCEEDED;
     }
     else if (!isApproximationValid(mNextApproxR) || !isApproximationValid(mNextApproxZ))
     {
-        printf("Fluid relaxation invalid result\n\n");
+        print_message("Fluid relaxation invalid result\n\n");
         return ResultCode::FLUID_INVALID_RESULT;
     }
     else
     {
+        detachSavedResult();
+
         for (arr_size_t i = 0; i < mPointsNum; i++)
         {
             mLastValidResult(i).r = mNextApproxR(i);
@@ -202,108 +583,193 @@ ResultCode MagneticFluid::calcRelaxation()
         }
     }
 
-    printf("Fluid relaxation calculated\n\n");
+    print_message("Fluid relaxation calculated\n\n");
 
     return ResultCode::FLUID_SUCCESS;
 }
 
 
-void MagneticFluid::calcNextApproximationR(const Array<double>& valZ, const Array<double>& prevValZ)
+void MagneticFluid::detachSavedResult()
 {
-    double integralCbrt = cbrt(calcIntegralTrapeze(mCurApproxR, prevValZ));
-    double integralCbrtSq = integralCbrt * integralCbrt;
-    double valQ = calcQ(mCurApproxR, prevValZ, integralCbrt);
-    double tmp = 0.0;
+    // saved buffer takes the current one, which is overwritten entirely afterwards
+    if (!mIsSavedResultDetached)
+    {
+        mLastValidResult.swap(mSavedResult);
+        mIsSavedResultDetached = true;
+    }
+}
 
-    mRightSweep(RS_MAIN_DIAGONAL, 0) = 1.0;
-    mRightSweep(RS_UPPER_DIAGONAL, 0) = 0.0;
 
-    mRightSweep(RS_MAIN_DIAGONAL, 1) = 1.0;
-    mRightSweep(RS_UPPER_DIAGONAL, 1) = 0.0;
-    mRightSweep(RS_LOWER_DIAGONAL, 0) = 0.0;
+void MagneticFluid::calcMatrixR()
+{
+    // matrix of the R equation does not depend on the approximation, so it is factorized once
+    mRightSweepR(RS_MAIN_DIAGONAL, 0) = 1.0;
+    mRightSweepR(RS_UPPER_DIAGONAL, 0) = 0.0;
 
-    mRightSweep(RS_MAIN_DIAGONAL, mPointsNum - 1) = 1.0;
-    mRightSweep(RS_LOWER_DIAGONAL, mPointsNum - 2) = -1.0;
+    mRightSweepR(RS_MAIN_DIAGONAL, 1) = 1.0;
+    mRightSweepR(RS_UPPER_DIAGONAL, 1) = 0.0;
+    mRightSweepR(RS_LOWER_DIAGONAL, 0) = 0.0;
 
-    mRightSweep(RS_CONST_TERMS, 0) = 0.0;
-    mRightSweep(RS_CONST_TERMS, 1) = mStep;
-    mRightSweep(RS_CONST_TERMS, mPointsNum - 1) = 0.5 * mStep * mStep *
-                                                  (valQ - 
-                                                  calcMagneticF(mCurApproxR, prevValZ, mPointsNum - 1, integralCbrt) + 
-                                                  1.0 / mCurApproxR(mPointsNum - 1));
+    mRightSweepR(RS_MAIN_DIAGONAL, mPointsNum - 1) = 1.0;
+    mRightSweepR(RS_LOWER_DIAGONAL, mPointsNum - 2) = -1.0;
 
     arr_size_t limit = mPointsNum - 1;
     for (arr_size_t i = 2; i < limit; i++)
     {
-        mRightSweep(RS_LOWER_DIAGONAL, i - 1) = 1.0;
-        mRightSweep(RS_MAIN_DIAGONAL, i) = -2.0;
-        mRightSweep(RS_UPPER_DIAGONAL, i) = 1.0;
-
-        tmp = 0.5 * (valZ(i + 1) - valZ(i - 1));
-        mRightSweep(RS_CONST_TERMS, i) = -mStep * tmp * (valQ - tmp / (mStep * mCurApproxR(i)) - 
-                                                         calcMagneticF(mCurApproxR, prevValZ, i, integralCbrt));
+        mRightSweepR(RS_LOWER_DIAGONAL, i - 1) = 1.0;
+        mRightSweepR(RS_MAIN_DIAGONAL, i) = -2.0;
+        mRightSweepR(RS_UPPER_DIAGONAL, i) = 1.0;
     }
 
-    mRightSweep.solve(mNextApproxR);
+    mRightSweepR.factorize();
 }
 
 
-void MagneticFluid::calcNextApproximationZ(const Array<double>& valR, const Array<double>& prevValR)
+void MagneticFluid::calcNextApproximationR(const Array<double>& valZ, const FluidIntegrals& integrals)
 {
-    double integralCbrt = cbrt(calcIntegralTrapeze(prevValR, mCurApproxZ));
-    double integralCbrtSq = integralCbrt * integralCbrt;
-    double valQ = calcQ(prevValR, mCurApproxZ, integralCbrt);
+    double valQ = integrals.valQ;
+    double magneticMultiplier = integrals.magneticMultiplier;
+
+    mRightSweepR(RS_CONST_TERMS, 0) = 0.0;
+    mRightSweepR(RS_CONST_TERMS, 1) = mStep;
+    mRightSweepR(RS_CONST_TERMS, mPointsNum - 1) = 0.5 * mStep * mStep *
+                                                   (valQ - 
+                                                   magneticMultiplier * mMagneticF(mPointsNum - 1) + 
+                                                   1.0 / mCurApproxR(mPointsNum - 1));
+
+    mRightSweepR.fill(RS_CONST_TERMS, 2, mPointsNum - 1, [&](arr_size_t i)
+    {
+        double tmp = 0.5 * (valZ(i + 1) - valZ(i - 1));
+        return -mStep * tmp * (valQ - tmp / (mStep * mCurApproxR(i)) - magneticMultiplier * mMagneticF(i));
+    });
+
+    mRightSweepR.solve(mNextApproxR);
+}
+
+
+void MagneticFluid::calcNextApproximationZ(const Array<double>& valR, 
+                                          const Array<double>& prevValR, 
+                                          const FluidIntegrals& integrals)
+{
+    double valQ = integrals.valQ;
+    double magneticMultiplier = integrals.magneticMultiplier;
     double tmp = 0.25 * mStep * mStep;
 
-    mRightSweep(RS_MAIN_DIAGONAL, 0) = -1.0;
-    mRightSweep(RS_UPPER_DIAGONAL, 0) = 1.0;
+    mRightSweepZ(RS_MAIN_DIAGONAL, 0) = -1.0;
+    mRightSweepZ(RS_UPPER_DIAGONAL, 0) = 1.0;
 
-    mRightSweep(RS_MAIN_DIAGONAL, mPointsNum - 2) = 1.0;
-    mRightSweep(RS_UPPER_DIAGONAL, mPointsNum - 2) = 0.0;
-    mRightSweep(RS_LOWER_DIAGONAL, mPointsNum - 3) = 0.0;
+    mRightSweepZ(RS_MAIN_DIAGONAL, mPointsNum - 2) = 1.0;
+    mRightSweepZ(RS_UPPER_DIAGONAL, mPointsNum - 2) = 0.0;
+    mRightSweepZ(RS_LOWER_DIAGONAL, mPointsNum - 3) = 0.0;
 
-    mRightSweep(RS_MAIN_DIAGONAL, mPointsNum - 1) = 1.0;
-    mRightSweep(RS_LOWER_DIAGONAL, mPointsNum - 2) = 0.0;
+    mRightSweepZ(RS_MAIN_DIAGONAL, mPointsNum - 1) = 1.0;
+    mRightSweepZ(RS_LOWER_DIAGONAL, mPointsNum - 2) = 0.0;
 
-    mRightSweep(RS_CONST_TERMS, 0) = tmp * (valQ - calcMagneticF(prevValR, mCurApproxZ, 0, integralCbrt));
-    mRightSweep(RS_CONST_TERMS, mPointsNum - 2) = mStep * (1.0 - 0.5 * mStep * 
-                                                  (valQ -
-                                                  calcMagneticF(prevValR, mCurApproxZ, mPointsNum - 1, integralCbrt) + 
-                                                  1.0 / prevValR(mPointsNum - 1)));
-    mRightSweep(RS_CONST_TERMS, mPointsNum - 1) = 0.0;
+    mRightSweepZ(RS_CONST_TERMS, 0) = tmp * (valQ - magneticMultiplier * mMagneticF(0));
+    mRightSweepZ(RS_CONST_TERMS, mPointsNum - 2) = mStep * (1.0 - 0.5 * mStep * 
+                                                   (valQ -
+                                                   magneticMultiplier * mMagneticF(mPointsNum - 1) + 
+                                                   1.0 / prevValR(mPointsNum - 1)));
+    mRightSweepZ(RS_CONST_TERMS, mPointsNum - 1) = 0.0;
 
-    arr_size_t limit = mPointsNum - 2;
-    for (arr_size_t i = 1; i < limit; i++)
+    mRightSweepZ.fillRows(1, mPointsNum - 2, [&](arr_size_t i)
     {
-        mRightSweep(RS_LOWER_DIAGONAL, i - 1) = 1.0 + valR(i - 1) / valR(i);
-        mRightSweep(RS_MAIN_DIAGONAL, i) = -(2.0 + (valR(i + 1) + valR(i - 1)) / valR(i));
-        mRightSweep(RS_UPPER_DIAGONAL, i) = 1.0 + valR(i + 1) / valR(i);
+        double invR = 1.0 / valR(i);
+
+        return RightSweepRow { 1.0 + valR(i - 1) * invR, 
+                               -(2.0 + (valR(i + 1) + valR(i - 1)) * invR), 
+                               1.0 + valR(i + 1) * invR, 
+                               mStep * (valR(i + 1) - valR(i - 1)) * (valQ - magneticMultiplier * mMagneticF(i)) };
+    });
+
+    mRightSweepZ.solve(mNextApproxZ);
+}
 
-        mRightSweep(RS_CONST_TERMS, i) = mStep * (valR(i + 1) - valR(i - 1)) * 
-                                                 (valQ - calcMagneticF(prevValR, mCurApproxZ, i, integralCbrt));
+
+void MagneticFluid::calcSpectralMatrixR()
+{
+    // collocation rows 1 and N are replaced by r'(0) = 1 and r'(1) = 0 as in the finite difference matrix
+    const Matrix<double>& diffMatrix = mCollocation.diffMatrix();
+    const Matrix<double>& secondDiffMatrix = mCollocation.secondDiffMatrix();
+    arr_size_t limit = mPointsNum - 1;
+
+    for (arr_size_t j = 0; j < mPointsNum; j++)
+    {
+        mSpectralSolverR(0, j) = (j == 0) ? 1.0 : 0.0;
+        mSpectralSolverR(1, j) = diffMatrix(0, j);
+        mSpectralSolverR(limit, j) = diffMatrix(limit, j);
+    }
+
+    for (arr_size_t i = 2; i < limit; i++)
+    {
+        for (arr_size_t j = 0; j < mPointsNum; j++)
+        {
+            mSpectralSolverR(i, j) = secondDiffMatrix(i, j);
+        }
     }
 
-    mRightSweep.solve(mNextApproxZ);
+    mSpectralSolverR.factorize();
 }
 
-#pragma endregion
 
+void MagneticFluid::calcSpectralApproximationR(const Array<double>& difZ, const FluidIntegrals& integrals)
+{
+    double valQ = integrals.valQ;
+    double magneticMultiplier = integrals.magneticMultiplier;
+    arr_size_t limit = mPointsNum - 1;
+
+    mSpectralSolverR.constTerm(0) = 0.0;
+    mSpectralSolverR.constTerm(1) = 1.0;
+    mSpectralSolverR.constTerm(limit) = 0.0;
+
+    for (arr_size_t i = 2; i < limit; i++)
+    {
+        mSpectralSolverR.constTerm(i) = -difZ(i) * (valQ - difZ(i) / mCurApproxR(i) - magneticMultiplier * mMagneticF(i));
+    }
+
+    mSpectralSolverR.solve(mNextApproxR);
+}
 
-#pragma region Integral calculations
 
-double MagneticFluid::calcIntegralTrapeze(const Array<double>& approxR, const Array<double>& approxZ) const
+void MagneticFluid::calcSpectralApproximationZ(const Array<double>& valR, const FluidIntegrals& integrals)
 {
-    double result = 0.0;
+    const Matrix<double>& diffMatrix = mCollocation.diffMatrix();
+    const Matrix<double>& secondDiffMatrix = mCollocation.secondDiffMatrix();
+    double valQ = integrals.valQ;
+    double magneticMultiplier = integrals.magneticMultiplier;
     arr_size_t limit = mPointsNum - 1;
 
-    for (arr_size_t i = 1; i < limit; i++)
+    // (r z')' = r r' (Q - F) is collocated at nodes 1..N-2, z'(0) = 0, z'(1) = -1 and z(1) = 0 close the system
+    mCollocation.differentiate(valR, mDifR);
+
+    for (arr_size_t j = 0; j < mPointsNum; j++)
     {
-        result += approxR(i) * approxZ(i) * (approxR(i + 1) - approxR(i - 1));
+        mSpectralSolverZ(0, j) = diffMatrix(0, j);
+        mSpectralSolverZ(limit - 1, j) = diffMatrix(limit, j);
+        mSpectralSolverZ(limit, j) = (j == limit) ? 1.0 : 0.0;
     }
 
-    return 2.0 * M_PI * result;
+    mSpectralSolverZ.constTerm(0) = 0.0;
+    mSpectralSolverZ.constTerm(limit - 1) = -1.0;
+    mSpectralSolverZ.constTerm(limit) = 0.0;
+
+    for (arr_size_t i = 1; i < limit - 1; i++)
+    {
+        for (arr_size_t j = 0; j < mPointsNum; j++)
+        {
+            mSpectralSolverZ(i, j) = valR(i) * secondDiffMatrix(i, j) + mDifR(i) * diffMatrix(i, j);
+        }
+
+        mSpectralSolverZ.constTerm(i) = valR(i) * mDifR(i) * (valQ - magneticMultiplier * mMagneticF(i));
+    }
+
+    mSpectralSolverZ.solve(mNextApproxZ);
 }
 
+#pragma endregion
+
+
+#pragma region Integral calculations
 
 double MagneticFluid::calcIntegralTrapeze(const Array<Vector2<double>>& approx) const
 {
@@ -319,59 +785,322 @@ double MagneticFluid::calcIntegralTrapeze(const Array<Vector2<double>>& approx)
 }
 
 
-double MagneticFluid::calcMagneticIntegralTrapeze(const Array<double>& approxR, 
-                                                  const Array<double>& approxZ, 
-                                                  double integralCbrt) const
+double MagneticFluid::calcIntegralSpectral(const Array<Vector2<double>>& approx) const
 {
+    const Matrix<double>& diffMatrix = mCollocation.diffMatrix();
     double result = 0.0;
+
+    // the same volume 2 pi sum(r z (dr)) with dr = 2 r' ds taken by Clenshaw-Curtis quadrature
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        double difR = 0.0;
+
+        for (arr_size_t j = 0; j < mPointsNum; j++)
+        {
+            difR += diffMatrix(i, j) * approx(j).r;
+        }
+
+        result += mCollocation.quadratureWeight(i) * approx(i).r * approx(i).z * difR;
+    }
+
+    return 4.0 * M_PI * result;
+}
+
+
+FluidIntegrals MagneticFluid::calcIntegrals(const Array<double>& approxR, const Array<double>& approxZ)
+{
+    FluidIntegrals result;
     arr_size_t limit = mPointsNum - 1;
+    double volumeSum = 0.0;
+    double magneticSum = 0.0;
+    double difR = 0.0;
 
+    // volume and magnetic integral are accumulated in the same traversal, mMagneticF keeps
+    // ((dPhi/dn)^2 + |grad Phi|^2 / chi) and is scaled by w / (2 cbrt(V)) once volume is known
     for (arr_size_t i = 1; i < limit; i++)
     {
-        result += approxR(i) * (approxR(i + 1) - approxR(i - 1)) * calcMagneticF(approxR, approxZ, i, integralCbrt);
+        difR = approxR(i + 1) - approxR(i - 1);
+
+        mMagneticF(i) = calcMagneticTerm(approxR, approxZ, i);
+
+        volumeSum += approxR(i) * approxZ(i) * difR;
+        magneticSum += approxR(i) * difR * mMagneticF(i);
     }
 
-    return 0.5 * result;
+    mMagneticF(0) = calcMagneticTerm(approxR, approxZ, 0);
+    mMagneticF(limit) = calcMagneticTerm(approxR, approxZ, limit);
+
+    double invRValue = 1.0 / approxR(limit);
+
+    result.volume = 2.0 * M_PI * volumeSum;
+    result.integralCbrt = cbrt(result.volume);
+    result.magneticMultiplier = 0.5 * mParams.w / result.integralCbrt;
+    result.magneticIntegral = 0.5 * result.magneticMultiplier * magneticSum;
+    result.valQ = -2.0 * invRValue * (1.0 - result.magneticIntegral * invRValue);
+
+    return result;
 }
 
-#pragma endregion 
 
+void MagneticFluid::calcIntegralsGradients(const Array<double>& approxR, 
+                                           const Array<double>& approxZ, 
+                                           const FluidIntegrals& integrals, 
+                                           Array<Vector2<double>>& multiplierGradientDest, 
+                                           Array<Vector2<double>>& valQGradientDest) const
+{
+    arr_size_t limit = mPointsNum - 1;
+    double magneticSum = 0.0;
+
+    // gradients of V and of S = sum(r (dr) F) are stored in the destinations before scaling
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        multiplierGradientDest(i) = { 0.0, 0.0 };
+        valQGradientDest(i) = { 0.0, 0.0 };
+    }
+
+    for (arr_size_t i = 1; i < limit; i++)
+    {
+        double difR = approxR(i + 1) - approxR(i - 1);
+        double difZ = approxZ(i + 1) - approxZ(i - 1);
+        double magneticTerm = calcMagneticTerm(approxR, approxZ, i);
+        double normalDerivative = 0.5 * (-difZ * mDerivativesR(i) + difR * mDerivativesZ(i)) / mStep;
+        double coef = approxR(i) * difR * normalDerivative / mStep;
+        double volumeCoef = 2.0 * M_PI * approxR(i) * approxZ(i);
+
+        magneticSum += approxR(i) * difR * magneticTerm;
+
+        multiplierGradientDest(i).r += 2.0 * M_PI * approxZ(i) * difR;
+        multiplierGradientDest(i).z += 2.0 * M_PI * approxR(i) * difR;
+        multiplierGradientDest(i + 1).r += volumeCoef;
+        multiplierGradientDest(i - 1).r -= volumeCoef;
+
+        valQGradientDest(i).r += difR * magneticTerm;
+        valQGradientDest(i + 1).r += approxR(i) * magneticTerm + coef * mDerivativesZ(i);
+        valQGradientDest(i - 1).r -= approxR(i) * magneticTerm + coef * mDerivativesZ(i);
+        valQGradientDest(i + 1).z -= coef * mDerivativesR(i);
+        valQGradientDest(i - 1).z += coef * mDerivativesR(i);
+    }
 
-#pragma region Special functions calculations
+    // mu = w / (2 cbrt(V)), M = mu S / 2, Q = -2 / r(N) + 2 M / r(N)^2
+    double multiplierVolumeDerivative = -integrals.magneticMultiplier / (3.0 * integrals.volume);
+    double invRValue = 1.0 / approxR(limit);
+    double valQIntegralDerivative = 2.0 * invRValue * invRValue;
+
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        Vector2<double> integralGradient = 0.5 * (magneticSum * multiplierVolumeDerivative * multiplierGradientDest(i) + 
+                                                  integrals.magneticMultiplier * valQGradientDest(i));
 
-double MagneticFluid::calcQ(const Array<double>& approxR, 
-                            const Array<double>& approxZ, 
-                            double integralCbrt) const
+        multiplierGradientDest(i) *= multiplierVolumeDerivative;
+        valQGradientDest(i) = valQIntegralDerivative * integralGradient;
+    }
+
+    valQGradientDest(limit).r += valQIntegralDerivative - 4.0 * integrals.magneticIntegral * invRValue * invRValue * invRValue;
+}
+
+
+FluidIntegrals MagneticFluid::calcSpectralIntegrals(const Array<double>& approxR, const Array<double>& approxZ)
 {
-    double invRValue = 1.0 / approxR(mPointsNum - 1);
-    double magneticIntegral = calcMagneticIntegralTrapeze(approxR, approxZ, integralCbrt);
-    return -2.0 * invRValue * (1.0 - magneticIntegral * invRValue);
+    FluidIntegrals result;
+    arr_size_t limit = mPointsNum - 1;
+    double volumeSum = 0.0;
+    double magneticSum = 0.0;
+
+    mCollocation.differentiate(approxR, mDifR);
+    mCollocation.differentiate(approxZ, mDifZ);
+
+    // derivatives are spectral, so the normal derivative has the same form at the end points
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        double weight = mCollocation.quadratureWeight(i);
+        double normalDerivative = -mDifZ(i) * mDerivativesR(i) + mDifR(i) * mDerivativesZ(i);
+
+        mMagneticF(i) = normalDerivative * normalDerivative + 
+                        (mDerivativesR(i) * mDerivativesR(i) + mDerivativesZ(i) * mDerivativesZ(i)) / mParams.chi;
+
+        volumeSum += weight * approxR(i) * approxZ(i) * mDifR(i);
+        magneticSum += weight * approxR(i) * mDifR(i) * mMagneticF(i);
+    }
+
+    double invRValue = 1.0 / approxR(limit);
+
+    result.volume = 4.0 * M_PI * volumeSum;
+    result.integralCbrt = cbrt(result.volume);
+    result.magneticMultiplier = 0.5 * mParams.w / result.integralCbrt;
+    result.magneticIntegral = result.magneticMultiplier * magneticSum;
+    result.valQ = -2.0 * invRValue * (1.0 - result.magneticIntegral * invRValue);
+
+    return result;
 }
 
+#pragma endregion
+
+
+#pragma region Newton calculations
 
-double MagneticFluid::calcMagneticF(const Array<double>& approxR, 
-                                    const Array<double>& approxZ, 
-                                    int index, 
-                                    double integralCbrt) const
+double MagneticFluid::calcMagneticTerm(const Array<double>& approxR, const Array<double>& approxZ, arr_size_t index) const
 {
-    double tmp = 0.0;
-    Vector2<double> deriv = mDerivatives(index);
+    double tangentialDerivativeSq = (mDerivativesR(index) * mDerivativesR(index) + 
+                                     mDerivativesZ(index) * mDerivativesZ(index)) / mParams.chi;
 
     if (index == 0)
     {
-        tmp = deriv.z;
+        return mDerivativesZ(0) * mDerivativesZ(0) + tangentialDerivativeSq;
     }
     else if (index == mPointsNum - 1)
     {
-        tmp = deriv.r;
+        return mDerivativesR(index) * mDerivativesR(index) + tangentialDerivativeSq;
     }
-    else
+
+    double normalDerivative = 0.5 * (-(approxZ(index + 1) - approxZ(index - 1)) * mDerivativesR(index) + 
+                                     (approxR(index + 1) - approxR(index - 1)) * mDerivativesZ(index)) / mStep;
+
+    return normalDerivative * normalDerivative + tangentialDerivativeSq;
+}
+
+
+void MagneticFluid::calcResidual(const Array<double>& approxR, 
+                                 const Array<double>& approxZ, 
+                                 double magneticMultiplier, 
+                                 double valQ, 
+                                 Array<Vector2<double>>& residualDest) const
+{
+    arr_size_t last = mPointsNum - 1;
+    double tmp = 0.0;
+
+    // r and z components hold residuals of the equations solved by R and Z half-steps at a fixed point
+    residualDest(0).r = approxR(0);
+    residualDest(1).r = approxR(1) - mStep;
+    residualDest(last).r = approxR(last) - approxR(last - 1) - 
+                           0.5 * mStep * mStep * (valQ - magneticMultiplier * calcMagneticTerm(approxR, approxZ, last) + 
+                                                  1.0 / approxR(last));
+
+    for (arr_size_t i = 2; i < last; i++)
     {
-        tmp = 0.5 * (-(approxZ(index + 1) - approxZ(index - 1)) * deriv.r +
-            (approxR(index + 1) - approxR(index - 1)) * deriv.z) / mStep;
+        tmp = 0.5 * (approxZ(i + 1) - approxZ(i - 1));
+
+        residualDest(i).r = approxR(i - 1) - 2.0 * approxR(i) + approxR(i + 1) + 
+                            mStep * tmp * (valQ - tmp / (mStep * approxR(i)) - 
+                                           magneticMultiplier * calcMagneticTerm(approxR, approxZ, i));
     }
 
-    return 0.5 * mParams.w * (tmp * tmp + (deriv.r * deriv.r + deriv.z * deriv.z) / mParams.chi) / integralCbrt;
+    residualDest(0).z = approxZ(1) - approxZ(0) - 
+                        0.25 * mStep * mStep * (valQ - magneticMultiplier * calcMagneticTerm(approxR, approxZ, 0));
+    residualDest(last - 1).z = approxZ(last - 1) - 
+                               mStep * (1.0 - 0.5 * mStep * (valQ - 
+                                                             magneticMultiplier * calcMagneticTerm(approxR, approxZ, last) + 
+                                                             1.0 / approxR(last)));
+    residualDest(last).z = approxZ(last);
+
+    for (arr_size_t i = 1; i < last - 1; i++)
+    {
+        double invR = 1.0 / approxR(i);
+
+        residualDest(i).z = (1.0 + approxR(i - 1) * invR) * approxZ(i - 1) - 
+                            (2.0 + (approxR(i + 1) + approxR(i - 1)) * invR) * approxZ(i) + 
+                            (1.0 + approxR(i + 1) * invR) * approxZ(i + 1) - 
+                            mStep * (approxR(i + 1) - approxR(i - 1)) * 
+                            (valQ - magneticMultiplier * calcMagneticTerm(approxR, approxZ, i));
+    }
+}
+
+
+void MagneticFluid::calcJacobian(const Array<double>& approxR, 
+                                 const Array<double>& approxZ, 
+                                 const FluidIntegrals& integrals, 
+                                 const Array<Vector2<double>>& residual)
+{
+    Array<double> perturbedR(approxR);
+    Array<double> perturbedZ(approxZ);
+    Array<double> steps(mPointsNum);
+    Array<Vector2<double>> perturbedResidual(mPointsNum);
+
+    // every equation couples neighbouring nodes only, so nodes of the same colour (index mod 3) are
+    // perturbed together and one residual evaluation gives three block columns at once
+    for (int column = 0; column < 2; column++)
+    {
+        const Array<double>& approx = (column == 0) ? approxR : approxZ;
+        Array<double>& perturbed = (column == 0) ? perturbedR : perturbedZ;
+
+        for (arr_size_t color = 0; color < 3; color++)
+        {
+            for (arr_size_t j = color; j < mPointsNum; j += 3)
+            {
+                perturbed(j) = approx(j) + NEWTON_DIFFERENCE_STEP * std::max(1.0, std::abs(approx(j)));
+                steps(j) = perturbed(j) - approx(j);
+            }
+
+            calcResidual(perturbedR, perturbedZ, integrals.magneticMultiplier, integrals.valQ, perturbedResidual);
+
+            for (arr_size_t j = color; j < mPointsNum; j += 3)
+            {
+                arr_size_t rowBegin = std::max(j - 1, 0);
+                arr_size_t rowEnd = std::min(j + 1, mPointsNum - 1);
+
+                for (arr_size_t i = rowBegin; i <= rowEnd; i++)
+                {
+                    Vector2<double> derivative = (perturbedResidual(i) - residual(i)) / steps(j);
+                    RightSweepAccessType accessType = (j == i) ? RS_MAIN_DIAGONAL : 
+                                                      (j < i) ? RS_LOWER_DIAGONAL : RS_UPPER_DIAGONAL;
+                    arr_size_t blockIndex = (j < i) ? j : i;
+
+                    mNewtonSweep(accessType, blockIndex, 0, column) = derivative.r;
+                    mNewtonSweep(accessType, blockIndex, 1, column) = derivative.z;
+                }
+
+                perturbed(j) = approx(j);
+            }
+        }
+    }
+}
+
+#pragma endregion
+
+
+#pragma region Error estimation
+
+double MagneticFluid::estimateError() const
+{
+    double result = 0.0;
+    arr_size_t limit = mPointsNum - 1;
+
+    if (mParams.isSpectral)
+    {
+        Array<double> values(mPointsNum);
+        Array<double> coefficientsR(mPointsNum);
+        Array<double> coefficientsZ(mPointsNum);
+
+        for (arr_size_t i = 0; i < mPointsNum; i++)
+        {
+            values(i) = mLastValidResult(i).r;
+        }
+
+        mCollocation.calcCoefficients(values, coefficientsR);
+
+        for (arr_size_t i = 0; i < mPointsNum; i++)
+        {
+            values(i) = mLastValidResult(i).z;
+        }
+
+        mCollocation.calcCoefficients(values, coefficientsZ);
+
+        // truncation error of a resolved expansion is of the order of its last coefficients
+        for (arr_size_t j = limit - 1; j <= limit; j++)
+        {
+            result = std::max(result, Vector2<double>(coefficientsR(j), coefficientsZ(j)).length());
+        }
+
+        return result;
+    }
+
+    // linear interpolation error bound of the surface, |x''| h^2 / 8 taken from second differences
+    for (arr_size_t i = 1; i < limit; i++)
+    {
+        Vector2<double> secondDif = mLastValidResult(i + 1) - 2.0 * mLastValidResult(i) + mLastValidResult(i - 1);
+        result = std::max(result, 0.125 * secondDif.length());
+    }
+
+    return result;
 }
 
 #pragma endregion
@@ -392,4 +1121,10 @@ bool MagneticFluid::isApproximationValid(const Array<double>& approx) const
     return true;
 }
 
+
+bool MagneticFluid::isCancelled() const
+{
+    return mCancellationFlag != nullptr && mCancellationFlag->load();
+}
+
 #pragma endregion
@@ -2,9 +2,14 @@
 #define DIPLOMA_MAGNETICFLUID_H
 
 
+#include <atomic>
 #include <functional>
 #include <unordered_map>
 #include "RightSweep.h"
+#include "BlockRightSweep.h"
+#include "DenseLUSolver.h"
+#include "ChebyshevCollocation.h"
+#include "AndersonAcceleration.h"
 #include "MagneticField.h"
 #include "result_codes.h"
 
@@ -18,9 +23,21 @@ typedef struct fluid_params_t
     double w;
     int splitsNum;
     int iterationsNumMax;
+    int andersonDepth;
     bool isRightSweepPedantic;
+    bool isNewtonEnabled;
+    bool isSpectral;
 } FluidParams;
 
+typedef struct fluid_integrals_t
+{
+    double volume;
+    double integralCbrt;
+    double magneticMultiplier;
+    double magneticIntegral;
+    double valQ;
+} FluidIntegrals;
+
 typedef std::function<void(const FluidParams& params, 
                            const Array<double>& nextApproxR, 
                            const Array<double>& nextApproxZ, 
@@ -46,22 +63,40 @@ public:
 
     double currentChi() const;
 
+    void setEpsilon(double epsilon);
+
+    double currentEpsilon() const;
+
     FluidParams parameters() const;
 
     arr_size_t pointsNum() const;
 
+    void setSplitsNum(int splitsNum);
+
     void setLastValidResult(const Array<Vector2<double>>& values);
 
+    void setResampledResult(const Array<Vector2<double>>& values);
+
     const Array<Vector2<double>>& lastValidResult() const;
 
+    void saveResult();
+
+    void restoreResult();
+
+    const Array<Vector2<double>>& savedResult() const;
+
     void setDerivatives(const Array<Vector2<double>>& values);
 
     double volumeNondimMul() const;
 
     double heightCoef() const;
 
+    double estimateError() const;
+
     void resetIterationsCounter();
 
+    void setCancellationFlag(const std::atomic<bool>* flag);
+
 
     void setActionForKey(const std::string& key, const MagneticFluidAction& action);
 
@@ -82,43 +117,98 @@ private:
     
     FluidParams mParams;
     
-    RightSweep mRightSweep;
+    RightSweep mRightSweepR;
+    RightSweep mRightSweepZ;
+    BlockRightSweep mNewtonSweep;
+
+    ChebyshevCollocation mCollocation;
+    DenseLUSolver mSpectralSolverR;
+    DenseLUSolver mSpectralSolverZ;
+
+    AndersonAcceleration mAnderson;
     
     Array<Vector2<double>> mLastValidResult;
-    Array<Vector2<double>> mDerivatives;
+    Array<Vector2<double>> mSavedResult;
+    bool mIsSavedResultDetached;
+    Array<double> mDerivativesR;
+    Array<double> mDerivativesZ;
+    Array<double> mMagneticF;
+    Array<double> mDifR;
+    Array<double> mDifZ;
     Array<double> mNextApproxR;
     Array<double> mNextApproxZ;
     Array<double> mCurApproxR;
     Array<double> mCurApproxZ;
+    Array<double> mStackedCurApprox;
+    Array<double> mStackedNextApprox;
+    double mPrevApproxDif;
     
     std::unordered_map<std::string, MagneticFluidAction> mActions;
+
+    const std::atomic<bool>* mCancellationFlag;
     
     
-    void calcNextApproximationR(const Array<double>& valZ, const Array<double>& prevValZ);
-    
-    void calcNextApproximationZ(const Array<double>& valR, const Array<double>& prevValR);
+    ResultCode calcFixedPointRelaxation();
+
+    ResultCode calcNewtonRelaxation();
+
+    ResultCode calcSpectralRelaxation();
+
+    ResultCode finishRelaxation(int counter);
+
+    void detachSavedResult();
+
+    void calcAcceleratedApproximation(double approxDif);
+
+
+    void calcMatrixR();
+
+    void calcNextApproximationR(const Array<double>& valZ, const FluidIntegrals& integrals);
     
+    void calcNextApproximationZ(const Array<double>& valR, 
+                                const Array<double>& prevValR, 
+                                const FluidIntegrals& integrals);
+
+
+    void calcSpectralMatrixR();
+
+    void calcSpectralApproximationR(const Array<double>& difZ, const FluidIntegrals& integrals);
+
+    void calcSpectralApproximationZ(const Array<double>& valR, const FluidIntegrals& integrals);
     
-    double calcIntegralTrapeze(const Array<double>& approxR, const Array<double>& approxZ) const;
     
     double calcIntegralTrapeze(const Array<Vector2<double>>& approx) const;
+
+    double calcIntegralSpectral(const Array<Vector2<double>>& approx) const;
     
-    double calcMagneticIntegralTrapeze(const Array<double>& approxR, 
-                                       const Array<double>& approxZ, 
-                                       double integralCbrt) const;
-    
-    
-    double calcQ(const Array<double>& approxR, 
-                 const Array<double>& approxZ, 
-                 double integralCbrt) const;
-    
-    double calcMagneticF(const Array<double>& approxR, 
-                         const Array<double>& approxZ, 
-                         int index, 
-                         double integralCbrt) const;
+    FluidIntegrals calcIntegrals(const Array<double>& approxR, const Array<double>& approxZ);
+
+    void calcIntegralsGradients(const Array<double>& approxR, 
+                                const Array<double>& approxZ, 
+                                const FluidIntegrals& integrals, 
+                                Array<Vector2<double>>& multiplierGradientDest, 
+                                Array<Vector2<double>>& valQGradientDest) const;
+
+    FluidIntegrals calcSpectralIntegrals(const Array<double>& approxR, const Array<double>& approxZ);
+
+
+    double calcMagneticTerm(const Array<double>& approxR, const Array<double>& approxZ, arr_size_t index) const;
+
+    void calcResidual(const Array<double>& approxR, 
+                      const Array<double>& approxZ, 
+                      double magneticMultiplier, 
+                      double valQ, 
+                      Array<Vector2<double>>& residualDest) const;
+
+    void calcJacobian(const Array<double>& approxR, 
+                      const Array<double>& approxZ, 
+                      const FluidIntegrals& integrals, 
+                      const Array<Vector2<double>>& residual);
     
     
     bool isApproximationValid(const Array<double>& approx) const;
+
+    bool isCancelled() const;
     
     
     void runActions() const;
@@ -1,9 +1,70 @@
 #include "Solution.h"
+#include "console_util.h"
 #include "math_ext.h"
+#include "GMRESSolver.h"
+#include <atomic>
 
 
 static const std::string FIELD_MODEL_ACTION_KEY = "field-model";
 
+// field is sampled for plots on a regular grid of this size instead of being smoothed by gnuplot
+static const arr_size_t SAMPLED_FIELD_SIZE = 60;
+
+static const int GRID_LEVEL_MIN_SPLITS_NUM = 4;
+static const arr_size_t GRID_LEVEL_MIN_FIELD_SPLITS_NUM = 2;
+
+// coupled state holds surface r, z and surface derivatives r, z of every fluid point
+static const int COUPLING_STATE_COMPONENTS_NUM = 4;
+
+// coupling mixing restarts from plain passes when the coupled residual grows by this factor
+static const double COUPLING_ANDERSON_SAFEGUARD_GROWTH = 1.0;
+
+// below this multiple of the accuracy passes are dominated by inner solvers tolerances,
+// so they are neither mixed nor differenced and plain segregated passes are taken
+static const double COUPLING_NOISE_MULTIPLIER = 1e4;
+
+static const int COUPLING_NEWTON_BACKTRACKS_MAX_NUM = 4;
+
+// Jacobian-vector products perturb the state by this multiple of the accuracy, so that
+// differences of passes stay well above the inner solvers tolerances
+static const double COUPLING_NEWTON_DIFFERENCE_MULTIPLIER = 1e3;
+
+static const int COUPLING_KRYLOV_RESTART_SIZE = 10;
+static const int COUPLING_KRYLOV_ITERATIONS_MAX_NUM = 10;
+static const double COUPLING_KRYLOV_TOLERANCE = 1e-2;
+
+// inexact coupling never solves inner problems looser than this multiple of the target accuracies
+static const double COUPLING_INEXACT_ACCURACY_MUL_MAX = 1e2;
+
+// Eisenstat-Walker forcing term parameters (choice 2), inner solvers stop on step size rather than
+// on residual, so the forcing term is kept well below the usual 0.9 or passes degrade to single sweeps
+static const double COUPLING_FORCING_TERM_MAX = 0.1;
+static const double COUPLING_FORCING_TERM_GAMMA = 0.1;
+static const double COUPLING_FORCING_TERM_ALPHA = 2.0;
+static const double COUPLING_FORCING_TERM_SAFEGUARD_MIN = 0.1;
+
+// pseudo-arclength steps are measured in points of surface r, z scaled to root mean square
+// and w scaled to the requested step, they grow after quick corrections and shrink on failures
+static const double ARCLENGTH_STEP_GROWTH_MUL = 1.5;
+static const double ARCLENGTH_STEP_SHRINK_MUL = 0.5;
+static const double ARCLENGTH_STEP_MIN_MUL = 1.0 / 64.0;
+static const int ARCLENGTH_QUICK_ITERATIONS_NUM = 5;
+static const int ARCLENGTH_CORRECTOR_ITERATIONS_MAX_NUM = 40;
+
+// plain passes finishing corrections below the noise floor are limited as well, so that a stalled
+// correction shortens the step instead of iterating forever
+static const int ARCLENGTH_CORRECTOR_PASSES_MAX_NUM = 1000;
+
+// results are landed on requested w by natural steps while the branch secant has at least this scaled w part,
+// near turning points w changes slowly along the branch and natural steps stall
+static const double ARCLENGTH_LANDING_SLOPE_MIN = 0.5;
+
+// continuation past turning points may never reach the target, so the number of steps is limited
+static const int ARCLENGTH_STEPS_MAX_MUL = 4;
+
+// speculative candidates take the current relaxation parameter and its successive halvings
+static const double SPECULATIVE_RELAXATION_PARAM_MUL = 0.5;
+
 
 #pragma region Parameters parsing
 
@@ -15,10 +76,13 @@ FluidParams getFluidParams(const ProblemParams& problemParams)
     fluidParams.chi = problemParams.chi;
     fluidParams.epsilon = problemParams.accuracy;
     fluidParams.iterationsNumMax = problemParams.iterationsMaxNum;
+    fluidParams.andersonDepth = problemParams.andersonDepth;
     fluidParams.relaxParamInitial = problemParams.relaxationParamInitial;
     fluidParams.relaxParamMin = problemParams.relaxationParamMin;
     fluidParams.splitsNum = problemParams.splitsNum;
     fluidParams.isRightSweepPedantic = problemParams.isRightSweepPedantic;
+    fluidParams.isNewtonEnabled = problemParams.isFluidNewtonEnabled;
+    fluidParams.isSpectral = problemParams.isFluidSpectral;
 
     return fluidParams;
 }
@@ -37,6 +101,112 @@ MagneticParams getFieldParams(const ProblemParams& problemParams)
     return fieldParams;
 }
 
+
+ProblemParams getCoarseParams(const ProblemParams& problemParams)
+{
+    ProblemParams coarseParams = problemParams;
+
+    coarseParams.splitsNum = std::max(problemParams.splitsNum / 2, GRID_LEVEL_MIN_SPLITS_NUM);
+    coarseParams.gridParams.surfaceSplitsNum = std::max(problemParams.gridParams.surfaceSplitsNum / 2, 
+                                                        GRID_LEVEL_MIN_FIELD_SPLITS_NUM);
+    coarseParams.gridParams.internalSplitsNum = std::max(problemParams.gridParams.internalSplitsNum / 2, 
+                                                         GRID_LEVEL_MIN_FIELD_SPLITS_NUM);
+    coarseParams.gridParams.externalSplitsNum = std::max(problemParams.gridParams.externalSplitsNum / 2, 
+                                                         GRID_LEVEL_MIN_FIELD_SPLITS_NUM);
+    coarseParams.gridLevelsNum = problemParams.gridLevelsNum - 1;
+    coarseParams.errorTolerance = 0.0;
+    coarseParams.fieldErrorTolerance = 0.0;
+
+    return coarseParams;
+}
+
+
+bool isCoarsenable(const ProblemParams& problemParams)
+{
+    ProblemParams coarseParams = getCoarseParams(problemParams);
+
+    return problemParams.gridLevelsNum > 1 && 
+           (coarseParams.splitsNum != problemParams.splitsNum || 
+            coarseParams.gridParams.surfaceSplitsNum != problemParams.gridParams.surfaceSplitsNum || 
+            coarseParams.gridParams.internalSplitsNum != problemParams.gridParams.internalSplitsNum || 
+            coarseParams.gridParams.externalSplitsNum != problemParams.gridParams.externalSplitsNum);
+}
+
+#pragma endregion
+
+
+#pragma region Speculative relaxation
+
+// Relaxation is calculated concurrently on copies of the solver with the current parameter and its halvings.
+// The largest successful parameter is taken, as serial halving after failures would have done, so smaller
+// candidates are cancelled as soon as a larger one succeeds. Solver is left untouched if all of them fail,
+// except for the parameter, which continues the halvings below the smallest one tried.
+template <typename Solver>
+static ResultCode calc_speculative_relaxation(Solver& solver, 
+                                              int candidatesNum, 
+                                              double relaxParamMin, 
+                                              ResultCode successCode)
+{
+    std::vector<Solver> candidates;
+    double relaxParam = solver.currentRelaxationParam();
+
+    for (int i = 0; i < candidatesNum && relaxParam >= relaxParamMin; i++)
+    {
+        candidates.push_back(solver);
+        candidates.back().setRelaxationParam(relaxParam);
+
+        relaxParam *= SPECULATIVE_RELAXATION_PARAM_MUL;
+    }
+
+    int launchedNum = (int)candidates.size();
+    std::vector<ResultCode> resultCodes(launchedNum, ResultCode::INVALID_RESULT);
+    std::vector<std::atomic<bool>> cancellationFlags(launchedNum);
+
+    for (int i = 0; i < launchedNum; i++)
+    {
+        cancellationFlags[i] = false;
+        candidates[i].setCancellationFlag(&cancellationFlags[i]);
+    }
+
+    print_message("Calculating %d relaxation candidates concurrently...\n\n", launchedNum);
+
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(std::max(launchedNum, 1))
+    for (int i = 0; i < launchedNum; i++)
+    {
+        resultCodes[i] = candidates[i].calcRelaxation();
+
+        if (resultCodes[i] == successCode)
+        {
+            for (int j = i + 1; j < launchedNum; j++)
+            {
+                cancellationFlags[j] = true;
+            }
+        }
+    }
+
+    for (int i = 0; i < launchedNum; i++)
+    {
+        if (resultCodes[i] == successCode)
+        {
+            print_message("Relaxation candidate %.3e taken\n\n", candidates[i].currentRelaxationParam());
+
+            solver = std::move(candidates[i]);
+            solver.setCancellationFlag(nullptr);
+
+            return successCode;
+        }
+    }
+
+    if (launchedNum == 0)
+    {
+        return ResultCode::INVALID_RESULT;
+    }
+
+    solver.setRelaxationParam(SPECULATIVE_RELAXATION_PARAM_MUL * candidates.back().currentRelaxationParam());
+
+    return resultCodes.back();
+}
+
 #pragma endregion
 
 
@@ -45,12 +215,23 @@ MagneticParams getFieldParams(const ProblemParams& problemParams)
 Solution::Solution(const ProblemParams& params) : mParams(params), 
                                                   mFluid(getFluidParams(params)), 
                                                   mField(getFieldParams(params)), 
-                                                  mLastValidFluidSurface(mFluid.pointsNum()), 
-                                                  mLastValidFieldGrid(mField.grid().parameters()), 
-                                                  mLastValidFieldPotential(mField.grid().rowsNum(), mField.grid().columnsNum()),
+                                                  mCouplingAnderson(COUPLING_STATE_COMPONENTS_NUM * mFluid.pointsNum(), 
+                                                                    params.couplingAndersonDepth),
+                                                  mCouplingApprox(COUPLING_STATE_COMPONENTS_NUM * mFluid.pointsNum()),
+                                                  mCouplingMappedApprox(COUPLING_STATE_COMPONENTS_NUM * mFluid.pointsNum()),
+                                                  mPrevCouplingDif(std::numeric_limits<double>::max()),
+                                                  mPrevCouplingResidual(std::numeric_limits<double>::max()),
+                                                  mCouplingForcingTerm(COUPLING_FORCING_TERM_MAX),
                                                   mLastFieldDiscrepancy(mField.grid().rowsNum(), mField.grid().columnsNum()),
                                                   mLastFieldDiscrepancyMin(std::numeric_limits<double>::max()),
-                                                  mLastFieldDiscrepancyMax(std::numeric_limits<double>::min())
+                                                  mLastFieldDiscrepancyMax(std::numeric_limits<double>::min()),
+                                                  mPrevConvergedSurface(mFluid.pointsNum()),
+                                                  mPrevConvergedPotential(mField.grid().rowsNum(), mField.grid().columnsNum()),
+                                                  mPrevConvergedW(0.0),
+                                                  mIsPrevConvergedValid(false),
+                                                  mArclengthStep(0.0),
+                                                  mArclengthStepMax(0.0),
+                                                  mArclengthStepsNum(0)
 {
     if (params.resultsNum == 1)
     {
@@ -62,6 +243,14 @@ Solution::Solution(const ProblemParams& params) : mParams(params),
         mStepW = params.wTarget / (params.resultsNum - 1);
         mCurW = 0.0;
     }
+
+    // w of arclength points is measured in requested steps, or as is when there are no steps
+    mArclengthScaleW = (mStepW > 0.0) ? mStepW : 1.0;
+
+    if (isCoarsenable(params))
+    {
+        mCoarseSolution = std::make_unique<Solution>(getCoarseParams(params));
+    }
 }
 
 #pragma endregion
@@ -74,6 +263,11 @@ void Solution::setChi(double chi)
     mParams.chi = chi;
     mFluid.setChi(chi);
     mField.setChi(chi);
+
+    if (mCoarseSolution)
+    {
+        mCoarseSolution->setChi(chi);
+    }
 }
 
 
@@ -113,10 +307,32 @@ const MagneticField& Solution::field() const
 }
 
 
+const Matrix<double>& Solution::fieldPotential() const
+{
+    return mField.savedResult();
+}
+
+
+const STGridLocator& Solution::fieldLocator() const
+{
+    if (!mFieldLocator || !mFieldLocator->isBuiltFor(mField.savedGrid()))
+    {
+        mFieldLocator = std::make_unique<STGridLocator>(mField.savedGrid());
+    }
+
+    return *mFieldLocator;
+}
+
+
 void Solution::resetIterationsCounters()
 {
     mFluid.resetIterationsCounter();
     mField.resetIterationsCounter();
+
+    if (mCoarseSolution)
+    {
+        mCoarseSolution->resetIterationsCounters();
+    }
 }
 
 #pragma endregion
@@ -140,7 +356,7 @@ FluidResultParams Solution::fluidResultParams() const
 
 FieldResultParams Solution::fieldResultParams() const
 {
-    arr_size_t rowsNum = mLastValidFieldGrid.rowsNum();
+    arr_size_t rowsNum = mField.savedGrid().rowsNum();
     arr_size_t surfaceColumnIndex = mField.grid().surfaceColumnsIndex();
     Vector2<double> limits = potentialLimits();
 
@@ -151,7 +367,7 @@ FieldResultParams Solution::fieldResultParams() const
     resultParams.potentialLabel = mParams.potentialLabel;
     resultParams.potentialMin = limits.x;
     resultParams.potentialMax = limits.y;
-    resultParams.fluidTopPotential = mLastValidFieldPotential(rowsNum - 1, surfaceColumnIndex);
+    resultParams.fluidTopPotential = mField.savedResult()(rowsNum - 1, surfaceColumnIndex);
     resultParams.chi = mParams.chi;
     resultParams.surfaceSplitsNum = mParams.gridParams.surfaceSplitsNum;
     resultParams.internalSplitsNum = mParams.gridParams.internalSplitsNum;
@@ -188,70 +404,91 @@ FieldModelParams Solution::fieldModelParams() const
 std::filesystem::path Solution::writeFluidData() const
 {
     double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
-    return write_fluid_data(fluidResultParams(), multiplier * mLastValidFluidSurface);
+    return write_fluid_data(fluidResultParams(), multiplier * mFluid.savedResult());
 }
 
 
 void Solution::writeFluidData(const std::filesystem::path& fluidDataPath) const
 {
     double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
-    write_fluid_data(fluidDataPath, fluidResultParams(), multiplier * mLastValidFluidSurface);
+    write_fluid_data(fluidDataPath, fluidResultParams(), multiplier * mFluid.savedResult());
 }
 
 
 std::filesystem::path Solution::writeFieldData() const
 {
     double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
-    return write_field_data(fieldResultParams(), multiplier * mLastValidFieldGrid.rawPoints(), mLastValidFieldPotential);
+    return write_field_data(fieldResultParams(), multiplier * mField.savedGrid().rawPoints(), mField.savedResult());
 }
 
 
 void Solution::writeFieldData(const std::filesystem::path& fieldDataPath) const
 {
     double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
-    write_field_data(fieldDataPath, fieldResultParams(), multiplier * mLastValidFieldGrid.rawPoints(), mLastValidFieldPotential);
+    write_field_data(fieldDataPath, fieldResultParams(), multiplier * mField.savedGrid().rawPoints(), mField.savedResult());
+}
+
+
+std::filesystem::path Solution::writeSampledFieldData() const
+{
+    Matrix<Vector2<double>> points(SAMPLED_FIELD_SIZE, SAMPLED_FIELD_SIZE);
+    Matrix<double> values(SAMPLED_FIELD_SIZE, SAMPLED_FIELD_SIZE);
+
+    calcSampledField(points, values);
+
+    return write_sampled_field_data(fieldResultParams(), points, values);
+}
+
+
+void Solution::writeSampledFieldData(const std::filesystem::path& sampledDataPath) const
+{
+    Matrix<Vector2<double>> points(SAMPLED_FIELD_SIZE, SAMPLED_FIELD_SIZE);
+    Matrix<double> values(SAMPLED_FIELD_SIZE, SAMPLED_FIELD_SIZE);
+
+    calcSampledField(points, values);
+    write_sampled_field_data(sampledDataPath, fieldResultParams(), points, values);
 }
 
 
 std::filesystem::path Solution::writeFieldErrorData() const
 {
     double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
-    return write_field_error_data(fieldModelParams(), multiplier * mLastValidFieldGrid.rawPoints(), mLastFieldDiscrepancy);
+    return write_field_error_data(fieldModelParams(), multiplier * mField.savedGrid().rawPoints(), mLastFieldDiscrepancy);
 }
 
 
 void Solution::writeFieldErrorData(const std::filesystem::path& errorDataPath) const
 {
     double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
-    write_field_error_data(errorDataPath, fieldModelParams(), multiplier * mLastValidFieldGrid.rawPoints(), mLastFieldDiscrepancy);
+    write_field_error_data(errorDataPath, fieldModelParams(), multiplier * mField.savedGrid().rawPoints(), mLastFieldDiscrepancy);
 }
 
 
 std::filesystem::path Solution::writeInternalGridData() const
 {
     double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
-    return write_internal_grid_data(fieldResultParams(), multiplier * mLastValidFieldGrid.rawPoints());
+    return write_internal_grid_data(fieldResultParams(), multiplier * mField.savedGrid().rawPoints());
 }
 
 
 void Solution::writeInternalGridData(const std::filesystem::path& gridDataPath) const
 {
     double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
-    write_internal_grid_data(gridDataPath, fieldResultParams(), multiplier * mLastValidFieldGrid.rawPoints());
+    write_internal_grid_data(gridDataPath, fieldResultParams(), multiplier * mField.savedGrid().rawPoints());
 }
 
 
 std::filesystem::path Solution::writeExternalGridData() const
 {
     double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
-    return write_external_grid_data(fieldResultParams(), multiplier * mLastValidFieldGrid.rawPoints());
+    return write_external_grid_data(fieldResultParams(), multiplier * mField.savedGrid().rawPoints());
 }
 
 
 void Solution::writeExternalGridData(const std::filesystem::path& gridDataPath) const
 {
     double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
-    write_external_grid_data(gridDataPath, fieldResultParams(), multiplier * mLastValidFieldGrid.rawPoints());
+    write_external_grid_data(gridDataPath, fieldResultParams(), multiplier * mField.savedGrid().rawPoints());
 }
 
 #pragma endregion
@@ -298,7 +535,7 @@ void Solution::fieldModelAction(const MagneticParams& params,
     mLastFieldDiscrepancyMin = std::numeric_limits<double>::max();
     mLastFieldDiscrepancyMax = std::numeric_limits<double>::min();
 
-    printf("\n=========================== FIELD DISCREPANCY ===========================\n");
+    print_message("\n=========================== FIELD DISCREPANCY ===========================\n");
 
     for (arr_size_t i = gridRowsNum - 1; i >= 0; i--)
     {
@@ -309,7 +546,7 @@ void Solution::fieldModelAction(const MagneticParams& params,
             mLastFieldDiscrepancyMin = std::min(mLastFieldDiscrepancyMin, discrepancy);
             mLastFieldDiscrepancyMax = std::max(mLastFieldDiscrepancyMax, discrepancy);
 
-            printf("%.3e ", discrepancy);
+            print_message("%.3e ", discrepancy);
         }
 
         discrepancy = std::abs(nextApprox(i, gridSurfaceColumnIndex) - b * grid(i, gridSurfaceColumnIndex).z);
@@ -317,7 +554,7 @@ void Solution::fieldModelAction(const MagneticParams& params,
         mLastFieldDiscrepancyMax = std::max(mLastFieldDiscrepancyMax, discrepancy);
         mLastFieldDiscrepancy(i, gridSurfaceColumnIndex) = discrepancy;
 
-        printf("| %.3e | ", discrepancy);
+        print_message("| %.3e | ", discrepancy);
 
         for (arr_size_t j = gridSurfaceColumnIndex + 1; j < gridColumnsNum; j++)
         {
@@ -328,13 +565,13 @@ void Solution::fieldModelAction(const MagneticParams& params,
             mLastFieldDiscrepancyMax = std::max(mLastFieldDiscrepancyMax, discrepancy);
             mLastFieldDiscrepancy(i, j) = discrepancy;
 
-            printf("%.3e ", discrepancy);
+            print_message("%.3e ", discrepancy);
         }
 
-        printf("\n");
+        print_message("\n");
     }
 
-    printf("\nMax discrepancy: %.3e \n\n", mLastFieldDiscrepancyMax);
+    print_message("\nMax discrepancy: %.3e \n\n", mLastFieldDiscrepancyMax);
 }
 
 #pragma endregion
@@ -355,29 +592,143 @@ void Solution::calcInitials()
     mFluid.setDerivatives(calcDerivatives());
 
     updateLastValidResults();
+
+    mIsPrevConvergedValid = false;
+    mArclengthStep = 0.0;
+    mArclengthStepMax = 0.0;
+    mArclengthStepsNum = 0;
+
+    if (mCoarseSolution)
+    {
+        mCoarseSolution->calcInitials();
+    }
+}
+
+
+void Solution::calcInitials(const SolutionState& state)
+{
+    loadState(state);
+
+    mIsPrevConvergedValid = false;
+    mArclengthStep = 0.0;
+    mArclengthStepMax = 0.0;
+    mArclengthStepsNum = 0;
+}
+
+
+ResultCode Solution::calcWarmResult(const SolutionState& state)
+{
+    // continuation history is kept, the current result becomes the last converged one before the warm one
+    SolutionState prevState = currentState();
+
+    loadState(state);
+
+    ResultCode resultCode = calcResult(state.w);
+
+    if (resultCode == ResultCode::SUCCESS || resultCode == ResultCode::TARGET_REACHED)
+    {
+        mPrevConvergedSurface = prevState.fluidSurface;
+        mPrevConvergedPotential = prevState.fieldPotential;
+        mPrevConvergedW = prevState.w;
+        mIsPrevConvergedValid = true;
+    }
+    else
+    {
+        mCurW = prevState.w;
+        loadState(prevState);
+    }
+
+    return resultCode;
 }
 
 
 ResultCode Solution::calcResult(double w)
+{
+    if (isAdaptive())
+    {
+        return calcAdaptiveResult(w);
+    }
+
+    return calcFixedResult(w);
+}
+
+
+ResultCode Solution::calcFixedResult(double w)
 {
     ResultCode resultCode = ResultCode::INVALID_RESULT;
 
+    if (mCoarseSolution)
+    {
+        print_message("Calculating coarse grid level...\n\n");
+
+        mCoarseSolution->setResampledState(*this);
+        resultCode = mCoarseSolution->calcResult(w);
+
+        if (resultCode == ResultCode::SUCCESS || resultCode == ResultCode::TARGET_REACHED)
+        {
+            setResampledState(*mCoarseSolution);
+        }
+
+        print_message("Coarse grid level calculated\n\n");
+
+        resultCode = ResultCode::INVALID_RESULT;
+    }
+
     mFluid.setW(w);
 
+    if (mCouplingAnderson.depth() > 0)
+    {
+        resetCouplingAcceleration();
+    }
+
+    if (mParams.isCouplingInexact)
+    {
+        resetInnerAccuracy();
+    }
+
+    bool isFluidRetried = false;
+    bool isFieldRetried = false;
+
     while (resultCode != ResultCode::SUCCESS &&
            mFluid.currentRelaxationParam() >= mParams.relaxationParamMin &&
            mField.currentRelaxationParam() >= mParams.fieldRelaxParamMin)
     {
-        resultCode = mFluid.calcRelaxation();
+        bool isFluidSpeculative = isFluidRetried && mParams.relaxationCandidatesNum > 1;
+        bool isFieldSpeculative = isFieldRetried && mParams.relaxationCandidatesNum > 1;
+
+        // passes retried after failures try several smaller relaxation parameters at once
+        if (isFluidSpeculative)
+        {
+            resultCode = calc_speculative_relaxation(mFluid, mParams.relaxationCandidatesNum, 
+                                                     mParams.relaxationParamMin, ResultCode::FLUID_SUCCESS);
+        }
+        else
+        {
+            resultCode = mFluid.calcRelaxation();
+        }
+
+        isFluidRetried = resultCode != ResultCode::FLUID_SUCCESS;
 
         if (resultCode == ResultCode::FLUID_SUCCESS)
         {
             mField.updateGrid(mFluid.lastValidResult());
-            resultCode = mField.calcRelaxation();
+
+            if (isFieldSpeculative)
+            {
+                resultCode = calc_speculative_relaxation(mField, mParams.relaxationCandidatesNum, 
+                                                         mParams.fieldRelaxParamMin, ResultCode::FIELD_SUCCESS);
+            }
+            else
+            {
+                resultCode = mField.calcRelaxation();
+            }
+
+            isFieldRetried = resultCode != ResultCode::FIELD_SUCCESS;
 
             if (resultCode == ResultCode::FIELD_SUCCESS)
             {
-                if (isAccuracyReached())
+                // pass with loosened inner solvers only shows that the full accuracy pass is due
+                if (isAccuracyReached() && isInnerAccuracyFull())
                 {
                     resultCode = ResultCode::SUCCESS;
                 }
@@ -386,28 +737,58 @@ ResultCode Solution::calcResult(double w)
                     resultCode = ResultCode::ACCURACY_NOT_REACHED;
                 }
 
+                if (resultCode == ResultCode::ACCURACY_NOT_REACHED && mParams.isCouplingInexact)
+                {
+                    updateInnerAccuracy(norm(mFluid.lastValidResult(), mFluid.savedResult()));
+                }
+
                 updateLastValidResults();
-                mFluid.setDerivatives(calcDerivatives());
+
+                if (resultCode == ResultCode::ACCURACY_NOT_REACHED && mCouplingAnderson.depth() > 0)
+                {
+                    calcAcceleratedCoupling();
+                }
+                else
+                {
+                    mFluid.setDerivatives(calcDerivatives());
+                }
             }
             else
             {
-                mFluid.setLastValidResult(mLastValidFluidSurface);
-                mField.setLastValidResult(mLastValidFieldPotential);
-                mField.setGrid(mLastValidFieldGrid);
+                mFluid.restoreResult();
+                mField.restoreResult();
 
-                mField.setRelaxationParam(0.5 * mField.currentRelaxationParam());
+                // failed candidates have already moved the parameter below the smallest one tried
+                if (!isFieldSpeculative)
+                {
+                    mField.setRelaxationParam(0.5 * mField.currentRelaxationParam());
+                }
             }
         }
         else
         {
-            mFluid.setLastValidResult(mLastValidFluidSurface);
-            mField.setLastValidResult(mLastValidFieldPotential);
-            mField.setGrid(mLastValidFieldGrid);
+            mFluid.restoreResult();
+            mField.restoreResult();
 
-            mFluid.setRelaxationParam(0.5 * mFluid.currentRelaxationParam());
+            if (!isFluidSpeculative)
+            {
+                mFluid.setRelaxationParam(0.5 * mFluid.currentRelaxationParam());
+            }
+        }
+
+        // failed pass might have been started from a mixed state, so mixing restarts from the last valid one
+        if (resultCode != ResultCode::SUCCESS && resultCode != ResultCode::ACCURACY_NOT_REACHED && 
+            mCouplingAnderson.depth() > 0)
+        {
+            resetCouplingAcceleration();
         }
     }
 
+    if (mParams.isCouplingInexact)
+    {
+        setInnerAccuracyMul(1.0);
+    }
+
     if (resultCode == ResultCode::SUCCESS)
     {
         mCurW = w;
@@ -426,10 +807,108 @@ ResultCode Solution::calcResult(double w)
 }
 
 
+ResultCode Solution::calcAdaptiveResult(double w)
+{
+    ResultCode resultCode = calcFixedResult(w);
+    int refinementsNum = 0;
+
+    while ((resultCode == ResultCode::SUCCESS || resultCode == ResultCode::TARGET_REACHED) && 
+           refinementsNum < mParams.refinementsMaxNum)
+    {
+        double fluidError = mFluid.estimateError();
+        FieldErrorEstimate fieldError = mField.estimateError();
+        int splitsNum = mParams.splitsNum;
+        STGridParams gridParams = mParams.gridParams;
+
+        print_message("Fluid error estimate: %.3e\n", fluidError);
+        print_message("Field error estimate: surface %.3e, internal %.3e, external %.3e\n\n", 
+               fieldError.surface, fieldError.internal, fieldError.external);
+
+        if (mParams.errorTolerance > 0.0 && fluidError > mParams.errorTolerance)
+        {
+            splitsNum *= 2;
+        }
+
+        if (mParams.fieldErrorTolerance > 0.0)
+        {
+            if (fieldError.surface > mParams.fieldErrorTolerance)
+            {
+                gridParams.surfaceSplitsNum *= 2;
+            }
+
+            if (fieldError.internal > mParams.fieldErrorTolerance)
+            {
+                gridParams.internalSplitsNum *= 2;
+            }
+
+            if (fieldError.external > mParams.fieldErrorTolerance)
+            {
+                gridParams.externalSplitsNum *= 2;
+            }
+        }
+
+        if (splitsNum == mParams.splitsNum && 
+            gridParams.surfaceSplitsNum == mParams.gridParams.surfaceSplitsNum && 
+            gridParams.internalSplitsNum == mParams.gridParams.internalSplitsNum && 
+            gridParams.externalSplitsNum == mParams.gridParams.externalSplitsNum)
+        {
+            break;
+        }
+
+        print_message("Raising resolution: fluid splits %d, field splits %d %d %d\n\n", splitsNum, 
+               gridParams.surfaceSplitsNum, gridParams.internalSplitsNum, gridParams.externalSplitsNum);
+
+        setResolution(splitsNum, gridParams);
+        resultCode = calcFixedResult(w);
+        refinementsNum++;
+    }
+
+    return resultCode;
+}
+
+
 ResultCode Solution::calcNextResult()
 {
     double nextW = mCurW + mStepW;
-    return calcResult(nextW);
+
+    if (mParams.isArclengthContinuation)
+    {
+        return calcArclengthResult();
+    }
+
+    return calcContinuationResult(nextW);
+}
+
+
+ResultCode Solution::calcContinuationResult(double nextW)
+{
+    if (!mParams.isSecantPredictorEnabled && !mParams.isArclengthContinuation)
+    {
+        return calcResult(nextW);
+    }
+
+    Array<Vector2<double>> convergedSurface = mFluid.savedResult();
+    Matrix<double> convergedPotential = mField.savedResult();
+    double convergedW = mCurW;
+
+    // arclength steps are predicted along the secant, so are the natural steps landing their results
+    if ((mParams.isSecantPredictorEnabled || mParams.isArclengthContinuation) && 
+        isPrevConvergedCompatible() && mCurW != mPrevConvergedW)
+    {
+        predictState((nextW - mCurW) / (mCurW - mPrevConvergedW));
+    }
+
+    ResultCode resultCode = calcResult(nextW);
+
+    if (resultCode == ResultCode::SUCCESS || resultCode == ResultCode::TARGET_REACHED)
+    {
+        mPrevConvergedSurface = convergedSurface;
+        mPrevConvergedPotential = convergedPotential;
+        mPrevConvergedW = convergedW;
+        mIsPrevConvergedValid = true;
+    }
+
+    return resultCode;
 }
 
 
@@ -475,7 +954,12 @@ ResultCode Solution::calcFieldModelProblem()
 
 Array<Vector2<double>> Solution::calcDerivatives() const
 {
-    arr_size_t pointsNum = mFluid.pointsNum();
+    return calcDerivatives(mFluid.pointsNum());
+}
+
+
+Array<Vector2<double>> Solution::calcDerivatives(arr_size_t pointsNum) const
+{
     arr_size_t limit = pointsNum - 1;
     Array<Vector2<double>> derivatives(pointsNum);
     double param = 0.0;
@@ -492,47 +976,844 @@ Array<Vector2<double>> Solution::calcDerivatives() const
 #pragma endregion
 
 
-#pragma region Update last valid result
+#pragma region Coupling acceleration
 
-void Solution::updateLastValidResults()
+void stack_coupling_state(const Array<Vector2<double>>& surface, 
+                          const Array<Vector2<double>>& derivatives, 
+                          Array<double>& stateDest)
 {
-    mLastValidFluidSurface = mFluid.lastValidResult();
-    mLastValidFieldGrid = mField.grid();
-    mLastValidFieldPotential = mField.lastValidResult();
-}
-
-#pragma endregion
+    arr_size_t pointsNum = surface.size();
 
+    for (arr_size_t i = 0; i < pointsNum; i++)
+    {
+        stateDest(i) = surface(i).r;
+        stateDest(pointsNum + i) = surface(i).z;
+        stateDest(2 * pointsNum + i) = derivatives(i).r;
+        stateDest(3 * pointsNum + i) = derivatives(i).z;
+    }
+}
 
-#pragma region Calculate limits
 
-Vector2<double> Solution::potentialLimits() const
+void unstack_coupling_state(const Array<double>& state, 
+                            Array<Vector2<double>>& surfaceDest, 
+                            Array<Vector2<double>>& derivativesDest)
 {
-    Vector2<double> result(std::numeric_limits<double>::max(), std::numeric_limits<double>::min());
-    arr_size_t rowsNum = mLastValidFieldPotential.rowsNum();
-    arr_size_t columnsNum = mLastValidFieldPotential.columnsNum();
+    arr_size_t pointsNum = surfaceDest.size();
 
-    for (arr_size_t i = 0; i < rowsNum; i++)
+    for (arr_size_t i = 0; i < pointsNum; i++)
     {
-        for (arr_size_t j = 0; j < columnsNum; j++)
-        {
-            result.x = (mLastValidFieldPotential(i, j) < result.x) ? mLastValidFieldPotential(i, j) : result.x;
-            result.y = (mLastValidFieldPotential(i, j) > result.y) ? mLastValidFieldPotential(i, j) : result.y;
-        }
+        surfaceDest(i) = { state(i), state(pointsNum + i) };
+        derivativesDest(i) = { state(2 * pointsNum + i), state(3 * pointsNum + i) };
     }
+}
 
-    return result;
+
+void Solution::resetCouplingAcceleration()
+{
+    Array<Vector2<double>> derivatives = calcDerivatives();
+
+    mCouplingAnderson.reset();
+    mPrevCouplingDif = std::numeric_limits<double>::max();
+
+    stack_coupling_state(mFluid.lastValidResult(), derivatives, mCouplingApprox);
+
+    mFluid.setDerivatives(derivatives);
 }
 
-#pragma endregion
 
+void Solution::calcAcceleratedCoupling()
+{
+    // one outer pass maps the state it was started from (mCouplingApprox) to the fluid surface
+    // it produced and field derivatives on that surface, the mixed state starts the next pass
+    Array<Vector2<double>> surface = mFluid.lastValidResult();
+    Array<Vector2<double>> derivatives = calcDerivatives();
+    arr_size_t pointsNum = mFluid.pointsNum();
+
+    stack_coupling_state(surface, derivatives, mCouplingMappedApprox);
 
-#pragma region Checks
+    double approxDif = norm(mCouplingMappedApprox, mCouplingApprox);
 
-bool Solution::isAccuracyReached() const
+    if (approxDif > COUPLING_ANDERSON_SAFEGUARD_GROWTH * mPrevCouplingDif || 
+        approxDif < COUPLING_NOISE_MULTIPLIER * mParams.accuracy)
+    {
+        mCouplingAnderson.reset();
+    }
+
+    mPrevCouplingDif = approxDif;
+
+    mCouplingAnderson.calcNextApproximation(mCouplingApprox, mCouplingMappedApprox, mCouplingApprox);
+
+    for (arr_size_t i = 0; i < COUPLING_STATE_COMPONENTS_NUM * pointsNum; i++)
+    {
+        if (!std::isfinite(mCouplingApprox(i)) || (i < 2 * pointsNum && mCouplingApprox(i) < -0.00001))
+        {
+            mCouplingAnderson.reset();
+            mCouplingApprox = mCouplingMappedApprox;
+            break;
+        }
+    }
+
+    unstack_coupling_state(mCouplingApprox, surface, derivatives);
+
+    mFluid.setLastValidResult(surface);
+    mFluid.setDerivatives(derivatives);
+}
+
+#pragma endregion
+
+
+#pragma region Pseudo-arclength continuation
+
+static double dot_product(const Array<double>& l, const Array<double>& r)
+{
+    double result = 0.0;
+    arr_size_t size = l.size();
+
+    for (arr_size_t i = 0; i < size; i++)
+    {
+        result += l(i) * r(i);
+    }
+
+    return result;
+}
+
+
+static double max_norm(const Array<double>& arr)
+{
+    double result = 0.0;
+    arr_size_t size = arr.size();
+
+    for (arr_size_t i = 0; i < size; i++)
+    {
+        result = std::max(result, std::abs(arr(i)));
+    }
+
+    return result;
+}
+
+
+static void stack_arclength_point(const Array<Vector2<double>>& surface, double param, Array<double>& pointDest)
+{
+    arr_size_t pointsNum = surface.size();
+    double mul = 1.0 / std::sqrt((double)pointsNum);
+
+    for (arr_size_t i = 0; i < pointsNum; i++)
+    {
+        pointDest(i) = mul * surface(i).r;
+        pointDest(pointsNum + i) = mul * surface(i).z;
+    }
+
+    pointDest(2 * pointsNum) = param;
+}
+
+
+static double calc_turning_point(double prevStep, double nextStep, double prevW, double curW, double nextW)
+{
+    // vertex of the parabola through w of three points against arclength, the current point is at zero
+    double prevDif = (curW - prevW) / prevStep;
+    double nextDif = (nextW - curW) / nextStep;
+    double mul = (nextDif - prevDif) / (prevStep + nextStep);
+
+    if (mul == 0.0)
+    {
+        return curW;
+    }
+
+    double vertex = -0.5 * prevStep - prevDif / (2.0 * mul);
+
+    return prevW + prevDif * (vertex + prevStep) + mul * (vertex + prevStep) * vertex;
+}
+
+
+ResultCode Solution::calcArclengthResult()
+{
+    // natural step from the first result gives the secant the following steps are predicted along
+    if (!isPrevConvergedCompatible())
+    {
+        return calcContinuationResult(mCurW + mStepW);
+    }
+
+    // arclength steps follow the branch between requested w, results are landed on them by natural steps
+    double requestedW = std::min(mCurW + mStepW, mParams.wTarget);
+    bool isLanded = false;
+    ResultCode resultCode = ResultCode::SUCCESS;
+
+    while (resultCode == ResultCode::SUCCESS && !isLanded)
+    {
+        resultCode = calcArclengthStep(requestedW, isLanded);
+    }
+
+    return resultCode;
+}
+
+
+ResultCode Solution::calcArclengthStep(double requestedW, bool& isLandedDest)
+{
+    isLandedDest = false;
+
+    if (mArclengthStepsNum >= ARCLENGTH_STEPS_MAX_MUL * mParams.resultsNum || mCurW < 0.0)
+    {
+        print_message("Arclength continuation steps limit exceeded\n\n");
+        return ResultCode::INVALID_RESULT;
+    }
+
+    arr_size_t pointsNum = mFluid.pointsNum();
+    arr_size_t pointSize = 2 * pointsNum + 1;
+    Array<double> prevPoint(pointSize);
+    Array<double> point(pointSize);
+    Array<double> nextPoint(pointSize);
+    Array<double> tangent(pointSize);
+
+    stack_arclength_point(mPrevConvergedSurface, mPrevConvergedW / mArclengthScaleW, prevPoint);
+    stack_arclength_point(mFluid.savedResult(), mCurW / mArclengthScaleW, point);
+
+    for (arr_size_t i = 0; i < pointSize; i++)
+    {
+        tangent(i) = point(i) - prevPoint(i);
+    }
+
+    double secantLength = std::sqrt(dot_product(tangent, tangent));
+
+    for (arr_size_t i = 0; i < pointSize; i++)
+    {
+        tangent(i) /= secantLength;
+    }
+
+    // requested w is landed on exactly by a natural step while the branch goes forward in w,
+    // arclength steps are only taken where w changes slowly along the branch
+    if (tangent(2 * pointsNum) >= ARCLENGTH_LANDING_SLOPE_MIN)
+    {
+        isLandedDest = true;
+        return calcContinuationResult(requestedW);
+    }
+
+    if (mArclengthStep <= 0.0)
+    {
+        mArclengthStep = secantLength;
+        mArclengthStepMax = secantLength;
+    }
+
+    SolutionState state = currentState();
+    Matrix<double> convergedPotential = mField.savedResult();
+    double convergedW = mCurW;
+    double prevW = mPrevConvergedW;
+
+    while (true)
+    {
+        double w = mCurW + mArclengthStep / secantLength * (mCurW - mPrevConvergedW);
+        int iterationsNum = 0;
+
+        print_message("Calculating arclength step %.3e from W = %.6f...\n\n", mArclengthStep, mCurW);
+
+        predictState(mArclengthStep / secantLength);
+
+        ResultCode resultCode = calcArclengthCorrector(tangent, point, mArclengthStep, w, iterationsNum);
+
+        // corrections reaching the requested w are finished on it by natural passes from where they stopped,
+        // the secant of the next step then runs from the last point before it
+        if (resultCode == ResultCode::SUCCESS && (w >= requestedW || std::abs(w - requestedW) <= 0.00001))
+        {
+            isLandedDest = true;
+            resultCode = calcResult(requestedW);
+
+            if (resultCode == ResultCode::SUCCESS || resultCode == ResultCode::TARGET_REACHED)
+            {
+                mPrevConvergedSurface = state.fluidSurface;
+                mPrevConvergedPotential = convergedPotential;
+                mPrevConvergedW = convergedW;
+                mIsPrevConvergedValid = true;
+
+                mArclengthStepsNum++;
+            }
+
+            return resultCode;
+        }
+
+        if (resultCode == ResultCode::SUCCESS)
+        {
+            stack_arclength_point(mFluid.savedResult(), w / mArclengthScaleW, nextPoint);
+
+            mPrevConvergedSurface = state.fluidSurface;
+            mPrevConvergedPotential = convergedPotential;
+            mPrevConvergedW = convergedW;
+            mIsPrevConvergedValid = true;
+
+            mCurW = w;
+            mArclengthStepsNum++;
+
+            if ((mCurW - convergedW) * (convergedW - prevW) < 0.0)
+            {
+                double nextStep = std::sqrt(dot_product(nextPoint, nextPoint) - 2.0 * dot_product(nextPoint, point) + 
+                                            dot_product(point, point));
+
+                print_message("Turning point between W = %.6f and W = %.6f, estimated at W = %.6f\n\n", 
+                       convergedW, mCurW, calc_turning_point(secantLength, nextStep, prevW, convergedW, mCurW));
+            }
+
+            if (iterationsNum <= ARCLENGTH_QUICK_ITERATIONS_NUM)
+            {
+                mArclengthStep = std::min(ARCLENGTH_STEP_GROWTH_MUL * mArclengthStep, mArclengthStepMax);
+            }
+
+            print_message("Arclength step calculated, W = %.6f\n\n", mCurW);
+
+            return ResultCode::SUCCESS;
+        }
+
+        restoreState(state);
+
+        // inner solvers failures are handled as in segregated passes, diverged corrections shorten the step
+        if (resultCode == ResultCode::FLUID_ITERATIONS_LIMIT_EXCEEDED || resultCode == ResultCode::FLUID_INVALID_RESULT)
+        {
+            mFluid.setRelaxationParam(0.5 * mFluid.currentRelaxationParam());
+        }
+        else if (resultCode == ResultCode::FIELD_ITERATIONS_LIMIT_EXCEEDED || 
+                 resultCode == ResultCode::FIELD_INVALID_RESULT)
+        {
+            mField.setRelaxationParam(0.5 * mField.currentRelaxationParam());
+        }
+        else
+        {
+            mArclengthStep *= ARCLENGTH_STEP_SHRINK_MUL;
+        }
+
+        if (mFluid.currentRelaxationParam() < mParams.relaxationParamMin ||
+            mField.currentRelaxationParam() < mParams.fieldRelaxParamMin)
+        {
+            print_message("Arclength step failed\n\n");
+            return resultCode;
+        }
+
+        // branch is followed by a natural step when the arclength step cannot be shortened any more,
+        // next arclength step starts anew from the secant it gives
+        if (mArclengthStep < ARCLENGTH_STEP_MIN_MUL * mArclengthStepMax)
+        {
+            print_message("Arclength step failed, falling back to natural step\n\n");
+
+            mArclengthStep = 0.0;
+
+            isLandedDest = true;
+            return calcContinuationResult(requestedW);
+        }
+
+        print_message("Arclength step failed, retrying with step %.3e\n\n", mArclengthStep);
+    }
+}
+
+
+ResultCode Solution::calcCoupledPass(const Array<double>& state, Array<double>& mappedStateDest)
+{
+    Array<Vector2<double>> surface(mFluid.pointsNum());
+    Array<Vector2<double>> derivatives(mFluid.pointsNum());
+
+    // every pass starts the field from the last accepted potential, so passes depend on the state only
+    unstack_coupling_state(state, surface, derivatives);
+
+    mFluid.setLastValidResult(surface);
+    mFluid.setDerivatives(derivatives);
+    mField.setLastValidResult(mField.savedResult());
+
+    ResultCode resultCode = mFluid.calcRelaxation();
+
+    if (resultCode != ResultCode::FLUID_SUCCESS)
+    {
+        return resultCode;
+    }
+
+    mField.updateGrid(mFluid.lastValidResult());
+    resultCode = mField.calcRelaxation();
+
+    if (resultCode != ResultCode::FIELD_SUCCESS)
+    {
+        return resultCode;
+    }
+
+    stack_coupling_state(mFluid.lastValidResult(), calcDerivatives(), mappedStateDest);
+
+    return ResultCode::SUCCESS;
+}
+
+
+ResultCode Solution::calcArclengthCorrector(const Array<double>& tangent, 
+                                            const Array<double>& point, 
+                                            double arclengthStep, 
+                                            double& wDest, 
+                                            int& iterationsNumDest)
+{
+    arr_size_t pointsNum = mFluid.pointsNum();
+    arr_size_t stateSize = COUPLING_STATE_COMPONENTS_NUM * pointsNum;
+    arr_size_t size = stateSize + 1;
+    double pointMul = 1.0 / std::sqrt((double)pointsNum);
+    GMRESSolver krylovSolver(size, COUPLING_KRYLOV_RESTART_SIZE);
+    Array<double> unknowns(size);
+    Array<double> residual(size);
+    Array<double> step(size);
+    Array<double> constTerms(size);
+    Array<double> trialUnknowns(size);
+    Array<double> trialResidual(size);
+    Array<double> state(stateSize);
+    Array<double> mappedState(stateSize);
+    Array<double> trialMappedState(stateSize);
+    double differenceStep = COUPLING_NEWTON_DIFFERENCE_MULTIPLIER * std::max(mParams.accuracy, mParams.fieldAccuracy);
+
+    auto calcDistance = [&](const Array<double>& curUnknowns)
+    {
+        double distance = tangent(2 * pointsNum) * (curUnknowns(stateSize) - point(2 * pointsNum)) - arclengthStep;
+
+        for (arr_size_t i = 0; i < 2 * pointsNum; i++)
+        {
+            distance += tangent(i) * (pointMul * curUnknowns(i) - point(i));
+        }
+
+        return distance;
+    };
+
+    // unknowns are the coupled state and w in requested steps, residual is the change of the state made
+    // by one segregated pass at that w and the distance to the plane orthogonal to the tangent
+    auto calcResidual = [&](const Array<double>& curUnknowns, Array<double>& mappedStateDest, Array<double>& residualDest)
+    {
+        for (arr_size_t i = 0; i < stateSize; i++)
+        {
+            state(i) = curUnknowns(i);
+        }
+
+        mFluid.setW(curUnknowns(stateSize) * mArclengthScaleW);
+
+        ResultCode resultCode = calcCoupledPass(state, mappedStateDest);
+
+        if (resultCode != ResultCode::SUCCESS)
+        {
+            return resultCode;
+        }
+
+        for (arr_size_t i = 0; i < stateSize; i++)
+        {
+            residualDest(i) = curUnknowns(i) - mappedStateDest(i);
+        }
+
+        residualDest(stateSize) = calcDistance(curUnknowns);
+
+        return ResultCode::SUCCESS;
+    };
+
+    LinearOperator jacobian = [&](const Array<double>& vector, Array<double>& productDest)
+    {
+        double curStep = differenceStep / max_norm(vector);
+
+        for (arr_size_t i = 0; i < size; i++)
+        {
+            trialUnknowns(i) = unknowns(i) + curStep * vector(i);
+        }
+
+        if (calcResidual(trialUnknowns, trialMappedState, trialResidual) != ResultCode::SUCCESS)
+        {
+            return false;
+        }
+
+        for (arr_size_t i = 0; i < size; i++)
+        {
+            productDest(i) = (trialResidual(i) - residual(i)) / curStep;
+        }
+
+        return true;
+    };
+
+    stack_coupling_state(mFluid.lastValidResult(), calcDerivatives(), state);
+
+    for (arr_size_t i = 0; i < stateSize; i++)
+    {
+        unknowns(i) = state(i);
+    }
+
+    unknowns(stateSize) = wDest / mArclengthScaleW;
+
+    ResultCode resultCode = calcResidual(unknowns, mappedState, residual);
+    int newtonIterationsNum = 0;
+
+    for (int k = 0; resultCode == ResultCode::SUCCESS; k++)
+    {
+        double surfaceDif = 0.0;
+        double residualNorm = max_norm(residual);
+
+        for (arr_size_t i = 0; i < 2 * pointsNum; i++)
+        {
+            surfaceDif = std::max(surfaceDif, std::abs(residual(i)));
+        }
+
+        // pass from the current unknowns is accepted the same way as segregated ones, on the constraint plane
+        bool isConverged = surfaceDif <= mParams.accuracy && std::abs(residual(stateSize)) <= mParams.accuracy && 
+                           norm(mField.lastValidResult(), mField.savedResult()) <= mParams.fieldAccuracy;
+
+        updateLastValidResults();
+
+        print_message("Arclength corrector iteration %d, W = %.6f, residual %.3e\n\n", k, unknowns(stateSize) * mArclengthScaleW, residualNorm);
+
+        if (isConverged)
+        {
+            wDest = unknowns(stateSize) * mArclengthScaleW;
+            iterationsNumDest = k;
+
+            mFluid.setDerivatives(calcDerivatives());
+
+            return ResultCode::SUCCESS;
+        }
+
+        if (newtonIterationsNum >= ARCLENGTH_CORRECTOR_ITERATIONS_MAX_NUM || k >= ARCLENGTH_CORRECTOR_PASSES_MAX_NUM)
+        {
+            return ResultCode::ACCURACY_NOT_REACHED;
+        }
+
+        for (arr_size_t i = 0; i < size; i++)
+        {
+            constTerms(i) = -residual(i);
+        }
+
+        bool isStepAccepted = false;
+
+        // Newton steps are not resolved below the noise floor of inner solvers, plain passes finish the state
+        if (residualNorm >= COUPLING_NOISE_MULTIPLIER * mParams.accuracy && 
+            krylovSolver.solve(jacobian, constTerms, step, COUPLING_KRYLOV_TOLERANCE, COUPLING_KRYLOV_ITERATIONS_MAX_NUM))
+        {
+            newtonIterationsNum++;
+
+            double stepMultiplier = 1.0;
+
+            for (int l = 0; l <= COUPLING_NEWTON_BACKTRACKS_MAX_NUM && !isStepAccepted; l++)
+            {
+                for (arr_size_t i = 0; i < size; i++)
+                {
+                    trialUnknowns(i) = unknowns(i) + stepMultiplier * step(i);
+                }
+
+                isStepAccepted = calcResidual(trialUnknowns, trialMappedState, trialResidual) == ResultCode::SUCCESS && 
+                                 max_norm(trialResidual) < residualNorm;
+
+                stepMultiplier *= 0.5;
+            }
+        }
+
+        // plain segregated pass is taken when Newton step is not better than the current unknowns,
+        // its result is moved along the tangent back onto the plane of the arclength constraint
+        if (isStepAccepted)
+        {
+            unknowns.swap(trialUnknowns);
+            mappedState.swap(trialMappedState);
+            residual.swap(trialResidual);
+        }
+        else
+        {
+            for (arr_size_t i = 0; i < stateSize; i++)
+            {
+                unknowns(i) = mappedState(i);
+            }
+
+            double distance = calcDistance(unknowns);
+
+            for (arr_size_t i = 0; i < 2 * pointsNum; i++)
+            {
+                unknowns(i) -= distance * tangent(i) / pointMul;
+            }
+
+            unknowns(stateSize) -= distance * tangent(2 * pointsNum);
+
+            resultCode = calcResidual(unknowns, mappedState, residual);
+        }
+    }
+
+    return resultCode;
+}
+
+#pragma endregion
+
+
+#pragma region Inexact coupling
+
+void Solution::setInnerAccuracyMul(double mul)
+{
+    mFluid.setEpsilon(mul * mParams.accuracy);
+    mField.setAccuracy(mul * mParams.fieldAccuracy);
+}
+
+
+void Solution::resetInnerAccuracy()
+{
+    mPrevCouplingResidual = std::numeric_limits<double>::max();
+    mCouplingForcingTerm = COUPLING_FORCING_TERM_MAX;
+
+    setInnerAccuracyMul(COUPLING_INEXACT_ACCURACY_MUL_MAX);
+}
+
+
+void Solution::updateInnerAccuracy(double couplingResidual)
+{
+    double forcingTerm = COUPLING_FORCING_TERM_MAX;
+
+    if (mPrevCouplingResidual < std::numeric_limits<double>::max())
+    {
+        // safeguard keeps the forcing term from dropping sharply after a single fast pass
+        double safeguard = COUPLING_FORCING_TERM_GAMMA * std::pow(mCouplingForcingTerm, COUPLING_FORCING_TERM_ALPHA);
+
+        forcingTerm = COUPLING_FORCING_TERM_GAMMA * 
+                      std::pow(couplingResidual / mPrevCouplingResidual, COUPLING_FORCING_TERM_ALPHA);
+
+        if (safeguard > COUPLING_FORCING_TERM_SAFEGUARD_MIN)
+        {
+            forcingTerm = std::max(forcingTerm, safeguard);
+        }
+
+        forcingTerm = std::min(forcingTerm, COUPLING_FORCING_TERM_MAX);
+    }
+
+    mPrevCouplingResidual = couplingResidual;
+    mCouplingForcingTerm = forcingTerm;
+
+    double mul = forcingTerm * couplingResidual / mParams.accuracy;
+
+    setInnerAccuracyMul(std::clamp(mul, 1.0, COUPLING_INEXACT_ACCURACY_MUL_MAX));
+}
+
+#pragma endregion
+
+
+#pragma region Continuation
+
+bool Solution::isPrevConvergedCompatible() const
+{
+    // states of different resolutions are not extrapolated, refinement has already resampled the current one
+    return mIsPrevConvergedValid && 
+           mPrevConvergedSurface.size() == mFluid.savedResult().size() && 
+           mPrevConvergedPotential.rowsNum() == mField.savedResult().rowsNum() && 
+           mPrevConvergedPotential.columnsNum() == mField.savedResult().columnsNum();
+}
+
+
+void Solution::predictState(double mul)
+{
+    const Array<Vector2<double>>& lastValidSurface = mFluid.savedResult();
+    const Matrix<double>& lastValidPotential = mField.savedResult();
+    arr_size_t pointsNum = lastValidSurface.size();
+    arr_size_t rowsNum = lastValidPotential.rowsNum();
+    arr_size_t columnsNum = lastValidPotential.columnsNum();
+    Array<Vector2<double>> surface(pointsNum);
+    Matrix<double> potential(rowsNum, columnsNum);
+
+    for (arr_size_t i = 0; i < pointsNum; i++)
+    {
+        surface(i) = lastValidSurface(i) + mul * (lastValidSurface(i) - mPrevConvergedSurface(i));
+
+        if (!std::isfinite(surface(i).x) || !std::isfinite(surface(i).y) || 
+            surface(i).x < -0.00001 || surface(i).y < -0.00001)
+        {
+            print_message("Secant predictor gives invalid surface, last converged state is used\n\n");
+            return;
+        }
+    }
+
+    for (arr_size_t i = 0; i < rowsNum; i++)
+    {
+        for (arr_size_t j = 0; j < columnsNum; j++)
+        {
+            potential(i, j) = lastValidPotential(i, j) + 
+                              mul * (lastValidPotential(i, j) - mPrevConvergedPotential(i, j));
+            potential(i, j) = std::max(potential(i, j), 0.0);
+        }
+    }
+
+    // potential nodes follow the surface by index, so the grid is regenerated from the predicted surface
+    mFluid.setLastValidResult(surface);
+    mField.updateGrid(mFluid.lastValidResult());
+    mField.setLastValidResult(potential);
+
+    mFluid.setDerivatives(calcDerivatives());
+
+    updateLastValidResults();
+}
+
+
+SolutionState Solution::currentState() const
+{
+    return { mFluid.savedResult(), mField.savedGrid(), mField.savedResult(), mCurW };
+}
+
+
+void Solution::loadState(const SolutionState& state)
+{
+    mFluid.setRelaxationParam(mParams.relaxationParamInitial);
+    mField.setRelaxationParam(mParams.fieldRelaxParamInitial);
+
+    // state might have been saved before refinements, so it is resampled to the current resolution
+    mFluid.setW(mCurW);
+    mFluid.setResampledResult(state.fluidSurface);
+    mField.updateGrid(mFluid.lastValidResult());
+    mField.setResampledResult(state.fieldPotential, state.fieldGrid.parameters());
+
+    mFluid.setDerivatives(calcDerivatives());
+
+    updateLastValidResults();
+
+    // coarse level is resampled from this one before every calculation, only its parameters are reset here
+    if (mCoarseSolution)
+    {
+        mCoarseSolution->calcInitials();
+    }
+}
+
+
+void Solution::restoreState(const SolutionState& state)
+{
+    mFluid.setW(mCurW);
+    mFluid.setLastValidResult(state.fluidSurface);
+    mField.setGrid(state.fieldGrid);
+    mField.setLastValidResult(state.fieldPotential);
+
+    mFluid.setDerivatives(calcDerivatives());
+
+    updateLastValidResults();
+}
+
+#pragma endregion
+
+
+#pragma region Update last valid result
+
+void Solution::updateLastValidResults()
+{
+    mFluid.saveResult();
+    mField.saveResult();
+}
+
+
+void Solution::setResampledState(const Solution& other)
+{
+    mFluid.setResampledResult(other.mFluid.savedResult());
+    mField.updateGrid(mFluid.lastValidResult());
+    mField.setResampledResult(other.mField.savedResult(), other.mField.savedGrid().parameters());
+
+    mFluid.setDerivatives(other.calcDerivatives(mFluid.pointsNum()));
+
+    updateLastValidResults();
+}
+
+
+void Solution::setResolution(int splitsNum, const STGridParams& gridParams)
+{
+    Array<Vector2<double>> surface = mFluid.savedResult();
+    Array<Vector2<double>> derivatives = calcDerivatives(splitsNum + 1);
+    Matrix<double> potential = mField.savedResult();
+    STGridParams potentialGridParams = mField.savedGrid().parameters();
+
+    mParams.splitsNum = splitsNum;
+    mParams.gridParams = gridParams;
+
+    mFluid.setSplitsNum(splitsNum);
+    mField.setGridParams(gridParams);
+
+    mLastFieldDiscrepancy = Matrix<double>(mField.grid().rowsNum(), mField.grid().columnsNum());
+
+    mFluid.setResampledResult(surface);
+    mField.updateGrid(mFluid.lastValidResult());
+    mField.setResampledResult(potential, potentialGridParams);
+    mFluid.setDerivatives(derivatives);
+
+    mCouplingAnderson = AndersonAcceleration(COUPLING_STATE_COMPONENTS_NUM * mFluid.pointsNum(), 
+                                             mParams.couplingAndersonDepth);
+    mCouplingApprox = Array<double>(COUPLING_STATE_COMPONENTS_NUM * mFluid.pointsNum());
+    mCouplingMappedApprox = Array<double>(COUPLING_STATE_COMPONENTS_NUM * mFluid.pointsNum());
+
+    updateLastValidResults();
+
+    if (isCoarsenable(mParams))
+    {
+        mCoarseSolution = std::make_unique<Solution>(getCoarseParams(mParams));
+    }
+    else
+    {
+        mCoarseSolution.reset();
+    }
+}
+
+#pragma endregion
+
+
+#pragma region Calculate limits
+
+Vector2<double> Solution::potentialLimits() const
+{
+    Vector2<double> result(std::numeric_limits<double>::max(), std::numeric_limits<double>::min());
+    const Matrix<double>& lastValidPotential = mField.savedResult();
+    arr_size_t rowsNum = lastValidPotential.rowsNum();
+    arr_size_t columnsNum = lastValidPotential.columnsNum();
+
+    for (arr_size_t i = 0; i < rowsNum; i++)
+    {
+        for (arr_size_t j = 0; j < columnsNum; j++)
+        {
+            result.x = (lastValidPotential(i, j) < result.x) ? lastValidPotential(i, j) : result.x;
+            result.y = (lastValidPotential(i, j) > result.y) ? lastValidPotential(i, j) : result.y;
+        }
+    }
+
+    return result;
+}
+
+
+void Solution::calcSampledField(Matrix<Vector2<double>>& pointsDest, Matrix<double>& valuesDest) const
+{
+    const Matrix<Vector2<double>>& gridPoints = mField.savedGrid().rawPoints();
+    double multiplier = (mParams.isDimensionless) ? volumeNonDimMul() : 1.0;
+    arr_size_t rowsNum = pointsDest.rowsNum();
+    arr_size_t columnsNum = pointsDest.columnsNum();
+    arr_size_t gridPointsNum = gridPoints.elementsNum();
+    Vector2<double> maxPoint;
+    Array<Vector2<double>> samplePoints(rowsNum * columnsNum);
+
+    for (arr_size_t i = 0; i < gridPointsNum; i++)
+    {
+        maxPoint.r = std::max(maxPoint.r, gridPoints(i).r);
+        maxPoint.z = std::max(maxPoint.z, gridPoints(i).z);
+    }
+
+    for (arr_size_t i = 0; i < rowsNum; i++)
+    {
+        for (arr_size_t j = 0; j < columnsNum; j++)
+        {
+            samplePoints(i * columnsNum + j) = { maxPoint.r * j / (columnsNum - 1), maxPoint.z * i / (rowsNum - 1) };
+        }
+    }
+
+    Array<double> sampleValues = fieldLocator().interpolate(mField.savedResult(), samplePoints);
+
+    for (arr_size_t i = 0; i < rowsNum; i++)
+    {
+        for (arr_size_t j = 0; j < columnsNum; j++)
+        {
+            pointsDest(i, j) = multiplier * samplePoints(i * columnsNum + j);
+            valuesDest(i, j) = sampleValues(i * columnsNum + j);
+        }
+    }
+}
+
+#pragma endregion
+
+
+#pragma region Checks
+
+bool Solution::isAccuracyReached() const
+{
+    return norm(mFluid.lastValidResult(), mFluid.savedResult()) <= mParams.accuracy &&
+           norm(mField.lastValidResult(), mField.savedResult()) <= mParams.fieldAccuracy;
+}
+
+
+bool Solution::isInnerAccuracyFull() const
+{
+    return mFluid.currentEpsilon() <= mParams.accuracy && mField.currentAccuracy() <= mParams.fieldAccuracy;
+}
+
+
+bool Solution::isAdaptive() const
 {
-    return norm(mFluid.lastValidResult(), mLastValidFluidSurface) <= mParams.accuracy &&
-           norm(mField.lastValidResult(), mLastValidFieldPotential) <= mParams.fieldAccuracy;
+    return mParams.refinementsMaxNum > 0 && (mParams.errorTolerance > 0.0 || mParams.fieldErrorTolerance > 0.0);
 }
 
 #pragma endregion
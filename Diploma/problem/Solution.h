@@ -2,8 +2,10 @@
 #define DIPLOMA_SOLUTION_H
 
 
+#include <memory>
 #include "MagneticFluid.h"
 #include "MagneticField.h"
+#include "STGridLocator.h"
 #include "files_util.h"
 
 
@@ -25,14 +27,34 @@ typedef struct problem_params_t
     double fieldAccuracy;
     double chi;
     double fieldModelChi;
+    double errorTolerance;
+    double fieldErrorTolerance;
     int splitsNum;
     int iterationsMaxNum;
     int fieldIterationsMaxNum;
     int resultsNum;
+    int gridLevelsNum;
+    int refinementsMaxNum;
+    int andersonDepth;
+    int couplingAndersonDepth;
+    int relaxationCandidatesNum;
     bool isRightSweepPedantic;
+    bool isFluidNewtonEnabled;
+    bool isFluidSpectral;
+    bool isCouplingInexact;
+    bool isSecantPredictorEnabled;
+    bool isArclengthContinuation;
     bool isDimensionless;
 } ProblemParams;
 
+typedef struct solution_state_t
+{
+    Array<Vector2<double>> fluidSurface;
+    SimpleTriangleGrid fieldGrid;
+    Matrix<double> fieldPotential;
+    double w;
+} SolutionState;
+
 
 class Solution
 {
@@ -54,6 +76,10 @@ public:
 
     const MagneticField& field() const;
 
+    const Matrix<double>& fieldPotential() const;
+
+    const STGridLocator& fieldLocator() const;
+
     void resetIterationsCounters();
 
 
@@ -72,6 +98,10 @@ public:
 
     void writeFieldData(const std::filesystem::path& fieldDataPath) const;
 
+    std::filesystem::path writeSampledFieldData() const;
+
+    void writeSampledFieldData(const std::filesystem::path& sampledDataPath) const;
+
     std::filesystem::path writeFieldErrorData() const;
 
     void writeFieldErrorData(const std::filesystem::path& errorDataPath) const;
@@ -94,8 +124,15 @@ public:
     void removeFieldActionForKey(const std::string& key);
     
     
+    SolutionState currentState() const;
+    
+    
     void calcInitials();
     
+    void calcInitials(const SolutionState& state);
+    
+    ResultCode calcWarmResult(const SolutionState& state);
+    
     ResultCode calcResult(double w);
     
     ResultCode calcNextResult();
@@ -107,31 +144,99 @@ private:
     
     MagneticField mField;
     MagneticFluid mFluid;
+
+    std::unique_ptr<Solution> mCoarseSolution;
+
+    // locator is built on the first use and rebuilt only when the saved field grid changes
+    mutable std::unique_ptr<STGridLocator> mFieldLocator;
+
+    AndersonAcceleration mCouplingAnderson;
+    Array<double> mCouplingApprox;
+    Array<double> mCouplingMappedApprox;
+    double mPrevCouplingDif;
+
+    double mPrevCouplingResidual;
+    double mCouplingForcingTerm;
     
-    SimpleTriangleGrid mLastValidFieldGrid;
-    Array<Vector2<double>> mLastValidFluidSurface;
-    Matrix<double> mLastValidFieldPotential;
     Matrix<double> mLastFieldDiscrepancy;
     
     double mLastFieldDiscrepancyMin;
     double mLastFieldDiscrepancyMax;
 
+    Array<Vector2<double>> mPrevConvergedSurface;
+    Matrix<double> mPrevConvergedPotential;
+    double mPrevConvergedW;
+    bool mIsPrevConvergedValid;
+
     double mCurW;
     double mStepW;
+
+    double mArclengthStep;
+    double mArclengthStepMax;
+    double mArclengthScaleW;
+    int mArclengthStepsNum;
     
     
     void updateLastValidResults();
+
+    void setResampledState(const Solution& other);
+
+    void setResolution(int splitsNum, const STGridParams& gridParams);
     
     Array<Vector2<double>> calcDerivatives() const;
+
+    Array<Vector2<double>> calcDerivatives(arr_size_t pointsNum) const;
+
+    void resetCouplingAcceleration();
+
+    void calcAcceleratedCoupling();
+
+    ResultCode calcCoupledPass(const Array<double>& state, Array<double>& mappedStateDest);
+
+    void setInnerAccuracyMul(double mul);
+
+    void resetInnerAccuracy();
+
+    void updateInnerAccuracy(double couplingResidual);
+
+    bool isPrevConvergedCompatible() const;
+
+    void predictState(double mul);
+
+    ResultCode calcContinuationResult(double w);
+
+    void loadState(const SolutionState& state);
+
+    void restoreState(const SolutionState& state);
+
+    ResultCode calcArclengthResult();
+
+    ResultCode calcArclengthStep(double requestedW, bool& isLandedDest);
+
+    ResultCode calcArclengthCorrector(const Array<double>& tangent, 
+                                      const Array<double>& point, 
+                                      double arclengthStep, 
+                                      double& wDest, 
+                                      int& iterationsNumDest);
     
     void fieldModelAction(const MagneticParams& params,
                           const Matrix<double>& nextApprox,
                           const Matrix<double>& curApprox,
                           const SimpleTriangleGrid& grid);
     
+    ResultCode calcFixedResult(double w);
+
+    ResultCode calcAdaptiveResult(double w);
+    
     bool isAccuracyReached() const;
+
+    bool isInnerAccuracyFull() const;
+
+    bool isAdaptive() const;
     
     Vector2<double> potentialLimits() const;
+
+    void calcSampledField(Matrix<Vector2<double>>& pointsDest, Matrix<double>& valuesDest) const;
 };
 
 
@@ -0,0 +1,301 @@
+#include "STGridLocator.h"
+#include "math_ext.h"
+
+
+static const double BARYCENTRIC_TOLERANCE = 1e-12;
+
+
+#pragma region Constructors
+
+STGridLocator::STGridLocator(const SimpleTriangleGrid& grid, arr_size_t bucketsNum)
+    : mPoints(grid.rawPoints()),
+      mMinPoint(),
+      mBucketSize(),
+      mBucketsDims(),
+      mBucketOffsets(),
+      mBucketTriangles()
+{
+    build(bucketsNum > 0 ? bucketsNum : trianglesNum());
+}
+
+#pragma endregion
+
+
+#pragma region Locator parameters
+
+arr_size_t STGridLocator::trianglesNum() const
+{
+    return 2 * (mPoints.rowsNum() - 1) * (mPoints.columnsNum() - 1);
+}
+
+
+arr_size_t STGridLocator::bucketsNum() const
+{
+    return mBucketsDims.i * mBucketsDims.j;
+}
+
+
+bool STGridLocator::isBuiltFor(const SimpleTriangleGrid& grid) const
+{
+    const Matrix<Vector2<double>>& gridPoints = grid.rawPoints();
+    arr_size_t elementsNum = mPoints.elementsNum();
+
+    if (gridPoints.rowsNum() != mPoints.rowsNum() || gridPoints.columnsNum() != mPoints.columnsNum())
+    {
+        return false;
+    }
+
+    for (arr_size_t i = 0; i < elementsNum; i++)
+    {
+        if (gridPoints(i).r != mPoints(i).r || gridPoints(i).z != mPoints(i).z)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#pragma endregion
+
+
+#pragma region Index building
+
+void STGridLocator::build(arr_size_t bucketsNumHint)
+{
+    arr_size_t elementsNum = mPoints.elementsNum();
+    arr_size_t triangles = trianglesNum();
+    Vector2<double> maxPoint = mPoints(0);
+    Vector2<arr_size_t> vertices[3];
+
+    mMinPoint = mPoints(0);
+
+    for (arr_size_t i = 1; i < elementsNum; i++)
+    {
+        mMinPoint.r = std::min(mMinPoint.r, mPoints(i).r);
+        mMinPoint.z = std::min(mMinPoint.z, mPoints(i).z);
+        maxPoint.r = std::max(maxPoint.r, mPoints(i).r);
+        maxPoint.z = std::max(maxPoint.z, mPoints(i).z);
+    }
+
+    Vector2<double> extent = maxPoint - mMinPoint;
+    double aspect = (extent.z > 0.0) ? extent.r / extent.z : 1.0;
+
+    // buckets are kept roughly square, about one triangle per bucket
+    mBucketsDims.i = std::max((arr_size_t)std::sqrt(bucketsNumHint / aspect), (arr_size_t)1);
+    mBucketsDims.j = std::max(bucketsNumHint / mBucketsDims.i, (arr_size_t)1);
+
+    mBucketSize.r = (extent.r > 0.0) ? extent.r / mBucketsDims.j : 1.0;
+    mBucketSize.z = (extent.z > 0.0) ? extent.z / mBucketsDims.i : 1.0;
+
+    mBucketOffsets.assign(bucketsNum() + 1, 0);
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (arr_size_t k = 0; k < triangles; k++)
+        {
+            triangleVertices(k, vertices);
+
+            Vector2<double> vert1 = mPoints(vertices[0]);
+            Vector2<double> vert2 = mPoints(vertices[1]);
+            Vector2<double> vert3 = mPoints(vertices[2]);
+
+            if (std::abs(double_triangle_area(vert1, vert2, vert3)) <= 0.0)
+            {
+                continue;
+            }
+
+            Vector2<double> triangleMin(std::min({ vert1.r, vert2.r, vert3.r }), std::min({ vert1.z, vert2.z, vert3.z }));
+            Vector2<double> triangleMax(std::max({ vert1.r, vert2.r, vert3.r }), std::max({ vert1.z, vert2.z, vert3.z }));
+            Vector2<arr_size_t> minBucket = bucketIndices(triangleMin);
+            Vector2<arr_size_t> maxBucket = bucketIndices(triangleMax);
+
+            for (arr_size_t i = minBucket.i; i <= maxBucket.i; i++)
+            {
+                for (arr_size_t j = minBucket.j; j <= maxBucket.j; j++)
+                {
+                    arr_size_t bucket = i * mBucketsDims.j + j;
+
+                    if (pass == 0)
+                    {
+                        mBucketOffsets[bucket + 1]++;
+                    }
+                    else
+                    {
+                        mBucketTriangles[mBucketOffsets[bucket]++] = k;
+                    }
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (size_t i = 1; i < mBucketOffsets.size(); i++)
+            {
+                mBucketOffsets[i] += mBucketOffsets[i - 1];
+            }
+
+            mBucketTriangles.resize(mBucketOffsets.back());
+        }
+        else
+        {
+            // second pass shifted every offset to the end of its bucket
+            for (size_t i = mBucketOffsets.size() - 1; i > 0; i--)
+            {
+                mBucketOffsets[i] = mBucketOffsets[i - 1];
+            }
+
+            mBucketOffsets[0] = 0;
+        }
+    }
+}
+
+
+void STGridLocator::triangleVertices(arr_size_t triangleIndex, Vector2<arr_size_t> (&vertices)[3]) const
+{
+    arr_size_t cellIndex = triangleIndex / 2;
+    arr_size_t i = cellIndex / (mPoints.columnsNum() - 1);
+    arr_size_t j = cellIndex % (mPoints.columnsNum() - 1);
+
+    if (triangleIndex % 2 == 0)
+    {
+        vertices[0] = { i, j };
+        vertices[1] = { i, j + 1 };
+        vertices[2] = { i + 1, j };
+    }
+    else
+    {
+        vertices[0] = { i + 1, j };
+        vertices[1] = { i, j + 1 };
+        vertices[2] = { i + 1, j + 1 };
+    }
+}
+
+
+Vector2<arr_size_t> STGridLocator::bucketIndices(const Vector2<double>& point) const
+{
+    Vector2<arr_size_t> result;
+
+    result.i = (arr_size_t)((point.z - mMinPoint.z) / mBucketSize.z);
+    result.j = (arr_size_t)((point.r - mMinPoint.r) / mBucketSize.r);
+
+    result.i = std::clamp(result.i, (arr_size_t)0, mBucketsDims.i - 1);
+    result.j = std::clamp(result.j, (arr_size_t)0, mBucketsDims.j - 1);
+
+    return result;
+}
+
+#pragma endregion
+
+
+#pragma region Location
+
+bool STGridLocator::calcWeights(arr_size_t triangleIndex, const Vector2<double>& point, STGridLocation& location) const
+{
+    Vector2<arr_size_t> vertices[3];
+
+    triangleVertices(triangleIndex, vertices);
+
+    Vector2<double> vert1 = mPoints(vertices[0]);
+    Vector2<double> vert2 = mPoints(vertices[1]);
+    Vector2<double> vert3 = mPoints(vertices[2]);
+
+    double doubleArea = double_triangle_area(vert1, vert2, vert3);
+    double weight1 = double_triangle_area(point, vert2, vert3) / doubleArea;
+    double weight2 = double_triangle_area(vert1, point, vert3) / doubleArea;
+    double weight3 = 1.0 - weight1 - weight2;
+
+    if (weight1 < -BARYCENTRIC_TOLERANCE || weight2 < -BARYCENTRIC_TOLERANCE || weight3 < -BARYCENTRIC_TOLERANCE)
+    {
+        return false;
+    }
+
+    location.vert1 = vertices[0];
+    location.vert2 = vertices[1];
+    location.vert3 = vertices[2];
+    location.weight1 = weight1;
+    location.weight2 = weight2;
+    location.weight3 = weight3;
+    location.isFound = true;
+
+    return true;
+}
+
+
+STGridLocation STGridLocator::locate(const Vector2<double>& point) const
+{
+    STGridLocation result;
+    Vector2<double> maxPoint(mMinPoint.r + mBucketSize.r * mBucketsDims.j, mMinPoint.z + mBucketSize.z * mBucketsDims.i);
+
+    result.isFound = false;
+
+    if (point.r < mMinPoint.r || point.z < mMinPoint.z || point.r > maxPoint.r || point.z > maxPoint.z)
+    {
+        return result;
+    }
+
+    Vector2<arr_size_t> bucket = bucketIndices(point);
+    arr_size_t bucketIndex = bucket.i * mBucketsDims.j + bucket.j;
+    arr_size_t limit = mBucketOffsets[bucketIndex + 1];
+
+    for (arr_size_t k = mBucketOffsets[bucketIndex]; k < limit; k++)
+    {
+        if (calcWeights(mBucketTriangles[k], point, result))
+        {
+            break;
+        }
+    }
+
+    return result;
+}
+
+#pragma endregion
+
+
+#pragma region Interpolation
+
+double STGridLocator::interpolate(const Matrix<double>& values, const Vector2<double>& point) const
+{
+    assert_message(values.rowsNum() == mPoints.rowsNum() && values.columnsNum() == mPoints.columnsNum(),
+                   "Values cannot be interpolated because their dimensions differ from the grid ones");
+
+    STGridLocation location = locate(point);
+
+    if (!location.isFound)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return location.weight1 * values(location.vert1) +
+           location.weight2 * values(location.vert2) +
+           location.weight3 * values(location.vert3);
+}
+
+
+void STGridLocator::interpolate(const Matrix<double>& values,
+                                const Array<Vector2<double>>& points,
+                                Array<double>& dest) const
+{
+    assert_message(points.size() == dest.size(),
+                   "Values cannot be interpolated because points and destination have different sizes");
+
+    arr_size_t pointsNum = points.size();
+
+    #pragma omp parallel for
+    for (arr_size_t i = 0; i < pointsNum; i++)
+    {
+        dest(i) = interpolate(values, points(i));
+    }
+}
+
+
+Array<double> STGridLocator::interpolate(const Matrix<double>& values, const Array<Vector2<double>>& points) const
+{
+    Array<double> result(points.size());
+
+    interpolate(values, points, result);
+
+    return result;
+}
+
+#pragma endregion
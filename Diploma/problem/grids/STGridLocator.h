@@ -0,0 +1,68 @@
+#ifndef DIPLOMA_ST_GRID_LOCATOR_H
+#define DIPLOMA_ST_GRID_LOCATOR_H
+
+#ifndef SIGNED_ARR_SIZE
+    #define SIGNED_ARR_SIZE
+#endif
+
+
+#include "SimpleTriangleGrid.h"
+
+
+typedef struct st_grid_location_t
+{
+    Vector2<arr_size_t> vert1;
+    Vector2<arr_size_t> vert2;
+    Vector2<arr_size_t> vert3;
+    double weight1;
+    double weight2;
+    double weight3;
+    bool isFound;
+} STGridLocation;
+
+
+// Uniform bucket index over SimpleTriangleGrid triangles.
+// Every grid cell (i, j) is split into triangles {(i, j), (i, j + 1), (i + 1, j)} and
+// {(i + 1, j), (i, j + 1), (i + 1, j + 1)}, the same ones used by MagneticField.
+class STGridLocator
+{
+public:
+    STGridLocator(const SimpleTriangleGrid& grid, arr_size_t bucketsNum = 0);
+
+
+    arr_size_t trianglesNum() const;
+
+    arr_size_t bucketsNum() const;
+
+    bool isBuiltFor(const SimpleTriangleGrid& grid) const;
+
+
+    STGridLocation locate(const Vector2<double>& point) const;
+
+    double interpolate(const Matrix<double>& values, const Vector2<double>& point) const;
+
+    void interpolate(const Matrix<double>& values, const Array<Vector2<double>>& points, Array<double>& dest) const;
+
+    Array<double> interpolate(const Matrix<double>& values, const Array<Vector2<double>>& points) const;
+
+private:
+    Matrix<Vector2<double>> mPoints;
+
+    Vector2<double> mMinPoint;
+    Vector2<double> mBucketSize;
+    Vector2<arr_size_t> mBucketsDims;
+
+    std::vector<arr_size_t> mBucketOffsets;
+    std::vector<arr_size_t> mBucketTriangles;
+
+
+    void build(arr_size_t bucketsNumHint);
+
+    void triangleVertices(arr_size_t triangleIndex, Vector2<arr_size_t> (&vertices)[3]) const;
+
+    Vector2<arr_size_t> bucketIndices(const Vector2<double>& point) const;
+
+    bool calcWeights(arr_size_t triangleIndex, const Vector2<double>& point, STGridLocation& location) const;
+};
+
+#endif
\ No newline at end of file
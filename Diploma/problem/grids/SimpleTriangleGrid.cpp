@@ -157,3 +157,21 @@ void SimpleTriangleGrid::generate(const Array<Vector2<double>>& surfacePoints)
 }
 
 #pragma endregion
+
+
+#pragma region Swap methods
+
+void SimpleTriangleGrid::swap(SimpleTriangleGrid& other)
+{
+    mPoints.swap(other.mPoints);
+    std::swap(mParams, other.mParams);
+    std::swap(mSurfaceColumnIndex, other.mSurfaceColumnIndex);
+}
+
+
+void swap(SimpleTriangleGrid& first, SimpleTriangleGrid& second)
+{
+    first.swap(second);
+}
+
+#pragma endregion
@@ -49,6 +49,9 @@ public:
 
     void generate(const Array<Vector2<double>>& surfacePoints);
 
+
+    void swap(SimpleTriangleGrid& other);
+
 private:
     Matrix<Vector2<double>> mPoints;
 
@@ -56,4 +59,7 @@ private:
     arr_size_t mSurfaceColumnIndex;
 };
 
+
+void swap(SimpleTriangleGrid& first, SimpleTriangleGrid& second);
+
 #endif
\ No newline at end of file
@@ -6,9 +6,11 @@ enum class ResultCode
     FLUID_SUCCESS,
     FLUID_ITERATIONS_LIMIT_EXCEEDED,
     FLUID_INVALID_RESULT,
+    FLUID_CANCELLED,
     FIELD_SUCCESS,
     FIELD_ITERATIONS_LIMIT_EXCEEDED,
     FIELD_INVALID_RESULT,
+    FIELD_CANCELLED,
     INVALID_RESULT,
     SUCCESS,
     TARGET_REACHED,
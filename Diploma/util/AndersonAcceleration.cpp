@@ -0,0 +1,222 @@
+#include "AndersonAcceleration.h"
+#include <algorithm>
+#include <cmath>
+
+
+// relative Tikhonov regularization of the least squares normal equations
+static const double ANDERSON_REGULARIZATION = 1e-10;
+
+
+#pragma region Linear system solution
+
+static bool solve_dense_system(std::vector<double>& matrix, std::vector<double>& terms, int size)
+{
+    // Gauss elimination with partial pivoting, matrix is stored by rows
+    for (int k = 0; k < size; k++)
+    {
+        int pivot = k;
+
+        for (int i = k + 1; i < size; i++)
+        {
+            if (std::abs(matrix[i * size + k]) > std::abs(matrix[pivot * size + k]))
+            {
+                pivot = i;
+            }
+        }
+
+        if (matrix[pivot * size + k] == 0.0 || !std::isfinite(matrix[pivot * size + k]))
+        {
+            return false;
+        }
+
+        if (pivot != k)
+        {
+            for (int j = 0; j < size; j++)
+            {
+                std::swap(matrix[k * size + j], matrix[pivot * size + j]);
+            }
+
+            std::swap(terms[k], terms[pivot]);
+        }
+
+        for (int i = k + 1; i < size; i++)
+        {
+            double coef = matrix[i * size + k] / matrix[k * size + k];
+
+            for (int j = k; j < size; j++)
+            {
+                matrix[i * size + j] -= coef * matrix[k * size + j];
+            }
+
+            terms[i] -= coef * terms[k];
+        }
+    }
+
+    for (int i = size - 1; i >= 0; i--)
+    {
+        for (int j = i + 1; j < size; j++)
+        {
+            terms[i] -= matrix[i * size + j] * terms[j];
+        }
+
+        terms[i] /= matrix[i * size + i];
+    }
+
+    return true;
+}
+
+#pragma endregion
+
+
+#pragma region Constructors
+
+AndersonAcceleration::AndersonAcceleration(arr_size_t size, int depth) 
+    : mSize(size), 
+      mDepth(std::max(depth, 0)), 
+      mHistorySize(0), 
+      mHistoryHead(0), 
+      mHasPrevious(false), 
+      mPrevResidual(size), 
+      mPrevMappedApprox(size), 
+      mResidual(size), 
+      mResidualDifs(std::max(depth, 0), Array<double>(size)), 
+      mMappedApproxDifs(std::max(depth, 0), Array<double>(size))
+{}
+
+#pragma endregion
+
+
+#pragma region Parameters
+
+arr_size_t AndersonAcceleration::size() const
+{
+    return mSize;
+}
+
+
+int AndersonAcceleration::depth() const
+{
+    return mDepth;
+}
+
+
+int AndersonAcceleration::historySize() const
+{
+    return mHistorySize;
+}
+
+
+void AndersonAcceleration::reset()
+{
+    mHistorySize = 0;
+    mHistoryHead = 0;
+    mHasPrevious = false;
+}
+
+#pragma endregion
+
+
+#pragma region Main calculations
+
+void AndersonAcceleration::calcNextApproximation(const Array<double>& approx, 
+                                                 const Array<double>& mappedApprox, 
+                                                 Array<double>& nextApproxDest)
+{
+    assert_message(approx.size() == mSize && mappedApprox.size() == mSize && nextApproxDest.size() == mSize, 
+                   "Anderson acceleration cannot be calculated for arrays of different sizes");
+
+    for (arr_size_t i = 0; i < mSize; i++)
+    {
+        mResidual(i) = mappedApprox(i) - approx(i);
+    }
+
+    if (mDepth > 0 && mHasPrevious)
+    {
+        // the oldest differences are overwritten when history is full
+        Array<double>& residualDif = mResidualDifs[mHistoryHead];
+        Array<double>& mappedApproxDif = mMappedApproxDifs[mHistoryHead];
+
+        for (arr_size_t i = 0; i < mSize; i++)
+        {
+            residualDif(i) = mResidual(i) - mPrevResidual(i);
+            mappedApproxDif(i) = mappedApprox(i) - mPrevMappedApprox(i);
+        }
+
+        mHistoryHead = (mHistoryHead + 1) % mDepth;
+        mHistorySize = std::min(mHistorySize + 1, mDepth);
+    }
+
+    mPrevResidual = mResidual;
+    mPrevMappedApprox = mappedApprox;
+    mHasPrevious = true;
+
+    nextApproxDest = mappedApprox;
+
+    std::vector<double> coefs;
+
+    if (mHistorySize == 0)
+    {
+        return;
+    }
+
+    if (!calcCoefficients(coefs))
+    {
+        reset();
+        return;
+    }
+
+    for (int k = 0; k < mHistorySize; k++)
+    {
+        const Array<double>& mappedApproxDif = mMappedApproxDifs[k];
+
+        for (arr_size_t i = 0; i < mSize; i++)
+        {
+            nextApproxDest(i) -= coefs[k] * mappedApproxDif(i);
+        }
+    }
+}
+
+
+bool AndersonAcceleration::calcCoefficients(std::vector<double>& coefsDest) const
+{
+    std::vector<double> matrix(mHistorySize * mHistorySize, 0.0);
+    double trace = 0.0;
+
+    coefsDest.assign(mHistorySize, 0.0);
+
+    // normal equations dF^T dF gamma = dF^T f of the least squares problem
+    for (int k = 0; k < mHistorySize; k++)
+    {
+        const Array<double>& residualDifK = mResidualDifs[k];
+
+        for (int l = k; l < mHistorySize; l++)
+        {
+            const Array<double>& residualDifL = mResidualDifs[l];
+            double product = 0.0;
+
+            for (arr_size_t i = 0; i < mSize; i++)
+            {
+                product += residualDifK(i) * residualDifL(i);
+            }
+
+            matrix[k * mHistorySize + l] = product;
+            matrix[l * mHistorySize + k] = product;
+        }
+
+        for (arr_size_t i = 0; i < mSize; i++)
+        {
+            coefsDest[k] += residualDifK(i) * mResidual(i);
+        }
+
+        trace += matrix[k * mHistorySize + k];
+    }
+
+    for (int k = 0; k < mHistorySize; k++)
+    {
+        matrix[k * mHistorySize + k] += ANDERSON_REGULARIZATION * trace;
+    }
+
+    return trace > 0.0 && solve_dense_system(matrix, coefsDest, mHistorySize);
+}
+
+#pragma endregion
@@ -0,0 +1,53 @@
+#ifndef DIPLOMA_ANDERSON_ACCELERATION_H
+#define DIPLOMA_ANDERSON_ACCELERATION_H
+
+#ifndef SIGNED_ARR_SIZE
+    #define SIGNED_ARR_SIZE
+#endif
+
+
+#include <vector>
+#include "Array.h"
+
+
+// Anderson(m) mixing for fixed-point iterations x = g(x).
+// Next approximation is g(x) - dG gamma, where gamma minimizes |f - dF gamma| over the last m
+// differences of residuals f = g(x) - x and of mapped approximations g(x).
+class AndersonAcceleration
+{
+public:
+    AndersonAcceleration(arr_size_t size, int depth);
+
+
+    arr_size_t size() const;
+
+    int depth() const;
+
+    int historySize() const;
+
+
+    void reset();
+
+    void calcNextApproximation(const Array<double>& approx, const Array<double>& mappedApprox, Array<double>& nextApproxDest);
+
+private:
+    arr_size_t mSize;
+
+    int mDepth;
+    int mHistorySize;
+    int mHistoryHead;
+
+    bool mHasPrevious;
+
+    Array<double> mPrevResidual;
+    Array<double> mPrevMappedApprox;
+    Array<double> mResidual;
+
+    std::vector<Array<double>> mResidualDifs;
+    std::vector<Array<double>> mMappedApproxDifs;
+
+
+    bool calcCoefficients(std::vector<double>& coefsDest) const;
+};
+
+#endif
\ No newline at end of file
@@ -88,6 +88,11 @@ public:
     void swap(Array<T>& other);
 
 
+    T* data();
+
+    const T* data() const;
+
+
     auto begin();
 
     const auto begin() const;
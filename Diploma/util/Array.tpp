@@ -299,6 +299,20 @@ inline Array<T>& Array<T>::operator/=(const K& r)
 
 #pragma region Iterator methods
 
+template <typename T>
+inline T* Array<T>::data()
+{
+    return &mElements[0];
+}
+
+
+template <typename T>
+inline const T* Array<T>::data() const
+{
+    return &mElements[0];
+}
+
+
 template <typename T>
 inline auto Array<T>::begin()
 {
@@ -0,0 +1,279 @@
+#include "BlockRightSweep.h"
+#include "console_util.h"
+#include <algorithm>
+
+
+#pragma region Block operations
+
+static const int BLOCK_SIZE = 4;
+static const int BLOCK_VECTOR_SIZE = 2;
+static const double PIVOT_TOLERANCE = 1e-12;
+
+
+static inline double block_norm(const double* block)
+{
+    return std::max(std::abs(block[0]) + std::abs(block[1]), std::abs(block[2]) + std::abs(block[3]));
+}
+
+
+static inline bool invert_block(const double* block, double* dest)
+{
+    double det = block[0] * block[3] - block[1] * block[2];
+    double norm = block_norm(block);
+
+    // pivot is singular when its determinant is lost in the rounding of its elements
+    if (!std::isfinite(det) || std::abs(det) <= PIVOT_TOLERANCE * norm * norm)
+    {
+        return false;
+    }
+
+    double invDet = 1.0 / det;
+
+    dest[0] = block[3] * invDet;
+    dest[1] = -block[1] * invDet;
+    dest[2] = -block[2] * invDet;
+    dest[3] = block[0] * invDet;
+
+    return true;
+}
+
+
+static inline void multiply_blocks(const double* l, const double* r, double* dest)
+{
+    double result0 = l[0] * r[0] + l[1] * r[2];
+    double result1 = l[0] * r[1] + l[1] * r[3];
+    double result2 = l[2] * r[0] + l[3] * r[2];
+    double result3 = l[2] * r[1] + l[3] * r[3];
+
+    dest[0] = result0;
+    dest[1] = result1;
+    dest[2] = result2;
+    dest[3] = result3;
+}
+
+
+static inline void multiply_block_vector(const double* block, const double* vector, double* dest)
+{
+    double result0 = block[0] * vector[0] + block[1] * vector[1];
+    double result1 = block[2] * vector[0] + block[3] * vector[1];
+
+    dest[0] = result0;
+    dest[1] = result1;
+}
+
+
+#pragma endregion
+
+
+#pragma region Constructors
+
+BlockRightSweep::BlockRightSweep(arr_size_t size, bool isPedantic) 
+    : mLowerDiagonal((size - 1) * BLOCK_SIZE), mMainDiagonal(size * BLOCK_SIZE), 
+      mUpperDiagonal((size - 1) * BLOCK_SIZE), mConstTerms(size * BLOCK_VECTOR_SIZE), 
+      mAlpha((size - 1) * BLOCK_SIZE), mBeta(size * BLOCK_VECTOR_SIZE), mInvDenominators(size * BLOCK_SIZE), 
+      mSize(size), mIsPedantic(isPedantic), mIsFactorized(false) {}
+
+#pragma endregion
+
+
+#pragma region Right sweep parameters
+
+arr_size_t BlockRightSweep::size() const
+{
+    return mSize;
+}
+
+#pragma endregion
+
+
+#pragma region Access methods
+
+double& BlockRightSweep::operator()(RightSweepAccessType accessType, arr_size_t index, int row, int column)
+{
+    assert_message(index >= 0 && index < diagonalSize(accessType), "Block right sweep index out of bounds");
+    assert_message(row >= 0 && row < 2 && column >= 0 && column < 2, "Block right sweep block element out of bounds");
+
+    if (accessType == RS_CONST_TERMS)
+    {
+        return mConstTerms(index * BLOCK_VECTOR_SIZE + row);
+    }
+
+    return diagonal(accessType)[index * BLOCK_SIZE + row * 2 + column];
+}
+
+
+double* BlockRightSweep::diagonal(RightSweepAccessType accessType)
+{
+    switch (accessType)
+    {
+        case RS_LOWER_DIAGONAL:
+            mIsFactorized = false;
+            return mLowerDiagonal.data();
+
+        case RS_MAIN_DIAGONAL:
+            mIsFactorized = false;
+            return mMainDiagonal.data();
+
+        case RS_UPPER_DIAGONAL:
+            mIsFactorized = false;
+            return mUpperDiagonal.data();
+
+        case RS_CONST_TERMS:
+            return mConstTerms.data();
+
+        default:
+            assert_message(false, "Block right sweep unknown access type");
+            return nullptr;
+    }
+}
+
+
+arr_size_t BlockRightSweep::diagonalSize(RightSweepAccessType accessType) const
+{
+    return (accessType == RS_LOWER_DIAGONAL || accessType == RS_UPPER_DIAGONAL) ? mSize - 1 : mSize;
+}
+
+#pragma endregion
+
+
+#pragma region Public solve methods
+
+void BlockRightSweep::factorize()
+{
+    // block diagonal dominance is not required, Newton jacobians generally lack it,
+    // so the sweep is checked on its pivot blocks instead
+    if (!calcAlpha())
+    {
+        assert_message(!mIsPedantic, "Block right sweep matrix is singular!");
+        print_message("! Warning: Block right sweep matrix is singular ! \n");
+    }
+
+    mIsFactorized = true;
+}
+
+
+bool BlockRightSweep::isFactorized() const
+{
+    return mIsFactorized;
+}
+
+
+Array<Vector2<double>> BlockRightSweep::solve()
+{
+    Array<Vector2<double>> solution(mSize);
+
+    this->solve(solution);
+
+    return solution;
+}
+
+
+void BlockRightSweep::solve(Array<Vector2<double>>& solutionDest)
+{
+    assert_message(mSize == solutionDest.size(), 
+                   "Block right sweep solution cannot be calculated due to different size of solution destination");
+
+    if (!mIsFactorized)
+    {
+        factorize();
+    }
+
+    calcBeta();
+    reversal(solutionDest);
+}
+
+#pragma endregion
+
+
+#pragma region Private calculation methods
+
+bool BlockRightSweep::calcAlpha()
+{
+    const double* lower = mLowerDiagonal.data();
+    const double* main = mMainDiagonal.data();
+    const double* upper = mUpperDiagonal.data();
+    double* alpha = mAlpha.data();
+    double* invDenominators = mInvDenominators.data();
+    double denominator[BLOCK_SIZE];
+    bool isRegular = invert_block(main, invDenominators);
+
+    // D(i) = M(i) + L(i - 1) Alpha(i - 1), Alpha(i) = -D(i)^-1 U(i)
+    for (arr_size_t i = 0; i < mSize; i++)
+    {
+        arr_size_t cur = i * BLOCK_SIZE;
+
+        if (i > 0)
+        {
+            arr_size_t prev = cur - BLOCK_SIZE;
+
+            multiply_blocks(lower + prev, alpha + prev, denominator);
+
+            for (int k = 0; k < BLOCK_SIZE; k++)
+            {
+                denominator[k] += main[cur + k];
+            }
+
+            isRegular = invert_block(denominator, invDenominators + cur) && isRegular;
+        }
+
+        if (i < mSize - 1)
+        {
+            multiply_blocks(invDenominators + cur, upper + cur, alpha + cur);
+
+            for (int k = 0; k < BLOCK_SIZE; k++)
+            {
+                alpha[cur + k] = -alpha[cur + k];
+            }
+        }
+    }
+
+    return isRegular;
+}
+
+
+void BlockRightSweep::calcBeta()
+{
+    const double* lower = mLowerDiagonal.data();
+    const double* constTerms = mConstTerms.data();
+    const double* invDenominators = mInvDenominators.data();
+    double* beta = mBeta.data();
+    double tmp[BLOCK_VECTOR_SIZE];
+
+    multiply_block_vector(invDenominators, constTerms, beta);
+
+    for (arr_size_t i = 1; i < mSize; i++)
+    {
+        arr_size_t cur = i * BLOCK_VECTOR_SIZE;
+        arr_size_t prev = cur - BLOCK_VECTOR_SIZE;
+
+        multiply_block_vector(lower + (i - 1) * BLOCK_SIZE, beta + prev, tmp);
+
+        tmp[0] = constTerms[cur] - tmp[0];
+        tmp[1] = constTerms[cur + 1] - tmp[1];
+
+        multiply_block_vector(invDenominators + i * BLOCK_SIZE, tmp, beta + cur);
+    }
+}
+
+
+void BlockRightSweep::reversal(Array<Vector2<double>>& solutionDest)
+{
+    const double* alpha = mAlpha.data();
+    const double* beta = mBeta.data();
+    double next[BLOCK_VECTOR_SIZE] = { beta[(mSize - 1) * BLOCK_VECTOR_SIZE], beta[(mSize - 1) * BLOCK_VECTOR_SIZE + 1] };
+    double cur[BLOCK_VECTOR_SIZE];
+
+    solutionDest(mSize - 1) = { next[0], next[1] };
+
+    for (arr_size_t i = mSize - 2; i >= 0; i--)
+    {
+        multiply_block_vector(alpha + i * BLOCK_SIZE, next, cur);
+
+        next[0] = cur[0] + beta[i * BLOCK_VECTOR_SIZE];
+        next[1] = cur[1] + beta[i * BLOCK_VECTOR_SIZE + 1];
+
+        solutionDest(i) = { next[0], next[1] };
+    }
+}
+
+#pragma endregion
@@ -0,0 +1,59 @@
+#ifndef DIPLOMA_BLOCK_RIGHTSWEEP_H
+#define DIPLOMA_BLOCK_RIGHTSWEEP_H
+
+#include "RightSweep.h"
+
+
+// Right sweep for tridiagonal systems with 2x2 blocks.
+// Every block is stored contiguously in row-major order (a11, a12, a21, a22), lower block
+// with index i - 1 couples unknowns of row i with row i - 1, as in RightSweep.
+class BlockRightSweep
+{
+public:
+    BlockRightSweep(arr_size_t size, bool isPedantic = false);
+
+
+    arr_size_t size() const;
+
+
+    double& operator()(RightSweepAccessType accessType, arr_size_t index, int row, int column = 0);
+
+
+    double* diagonal(RightSweepAccessType accessType);
+
+    arr_size_t diagonalSize(RightSweepAccessType accessType) const;
+
+
+    void factorize();
+
+    bool isFactorized() const;
+
+
+    Array<Vector2<double>> solve();
+
+    void solve(Array<Vector2<double>>& solutionDest);
+
+private:
+    Array<double> mLowerDiagonal;
+    Array<double> mMainDiagonal;
+    Array<double> mUpperDiagonal;
+    Array<double> mConstTerms;
+
+    Array<double> mAlpha;
+    Array<double> mBeta;
+    Array<double> mInvDenominators;
+
+    arr_size_t mSize;
+
+    bool mIsPedantic;
+    bool mIsFactorized;
+
+
+    bool calcAlpha();
+
+    void calcBeta();
+
+    void reversal(Array<Vector2<double>>& solutionDest);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "ChebyshevCollocation.h"
+#include "math_ext.h"
+
+
+#pragma region Static helpers
+
+static inline double chebyshev_node(arr_size_t index, arr_size_t splitsNum)
+{
+    // (1 - cos(2a)) / 2 = sin(a)^2 keeps nodes near both ends accurate
+    double tmp = sin(M_PI_2 * index / splitsNum);
+    return tmp * tmp;
+}
+
+
+static inline double barycentric_weight(arr_size_t index, arr_size_t splitsNum)
+{
+    double result = (index % 2 == 0) ? 1.0 : -1.0;
+    return (index == 0 || index == splitsNum) ? 0.5 * result : result;
+}
+
+#pragma endregion
+
+
+#pragma region Constructors
+
+ChebyshevCollocation::ChebyshevCollocation(arr_size_t pointsNum)
+    : mPointsNum(pointsNum),
+      mNodes(pointsNum),
+      mBarycentricWeights(pointsNum),
+      mQuadratureWeights(pointsNum),
+      mDiffMatrix(pointsNum, pointsNum),
+      mSecondDiffMatrix(pointsNum, pointsNum)
+{
+    assert_message(pointsNum > 1, "Chebyshev collocation needs at least two points");
+
+    calcNodes();
+    calcQuadratureWeights();
+    calcDiffMatrices();
+}
+
+#pragma endregion
+
+
+#pragma region Collocation parameters
+
+arr_size_t ChebyshevCollocation::pointsNum() const
+{
+    return mPointsNum;
+}
+
+
+double ChebyshevCollocation::node(arr_size_t index) const
+{
+    return mNodes(index);
+}
+
+
+double ChebyshevCollocation::quadratureWeight(arr_size_t index) const
+{
+    return mQuadratureWeights(index);
+}
+
+
+const Matrix<double>& ChebyshevCollocation::diffMatrix() const
+{
+    return mDiffMatrix;
+}
+
+
+const Matrix<double>& ChebyshevCollocation::secondDiffMatrix() const
+{
+    return mSecondDiffMatrix;
+}
+
+#pragma endregion
+
+
+#pragma region Initialization
+
+void ChebyshevCollocation::calcNodes()
+{
+    arr_size_t splitsNum = mPointsNum - 1;
+
+    for (arr_size_t k = 0; k < mPointsNum; k++)
+    {
+        mNodes(k) = chebyshev_node(k, splitsNum);
+        mBarycentricWeights(k) = barycentric_weight(k, splitsNum);
+    }
+}
+
+
+void ChebyshevCollocation::calcQuadratureWeights()
+{
+    arr_size_t splitsNum = mPointsNum - 1;
+    double squaredSplitsNum = (double)splitsNum * splitsNum;
+    double endWeight = (splitsNum % 2 == 0) ? 1.0 / (squaredSplitsNum - 1.0) : 1.0 / squaredSplitsNum;
+
+    // Clenshaw-Curtis weights of [-1, 1] are halved for [0, 1]
+    mQuadratureWeights(0) = 0.5 * endWeight;
+    mQuadratureWeights(splitsNum) = 0.5 * endWeight;
+
+    for (arr_size_t k = 1; k < splitsNum; k++)
+    {
+        double theta = M_PI * k / splitsNum;
+        double sum = 1.0;
+
+        for (arr_size_t j = 1; 2 * j < splitsNum; j++)
+        {
+            sum -= 2.0 * cos(2.0 * j * theta) / (4.0 * j * j - 1.0);
+        }
+
+        if (splitsNum % 2 == 0)
+        {
+            sum -= cos(splitsNum * theta) / (squaredSplitsNum - 1.0);
+        }
+
+        mQuadratureWeights(k) = sum / splitsNum;
+    }
+}
+
+
+void ChebyshevCollocation::calcDiffMatrices()
+{
+    // barycentric formulas, diagonals are negative off-diagonal sums so that constants are differentiated exactly
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        double diagonalSum = 0.0;
+
+        for (arr_size_t j = 0; j < mPointsNum; j++)
+        {
+            if (j != i)
+            {
+                mDiffMatrix(i, j) = mBarycentricWeights(j) / (mBarycentricWeights(i) * (mNodes(i) - mNodes(j)));
+                diagonalSum += mDiffMatrix(i, j);
+            }
+        }
+
+        mDiffMatrix(i, i) = -diagonalSum;
+    }
+
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        double diagonalSum = 0.0;
+
+        for (arr_size_t j = 0; j < mPointsNum; j++)
+        {
+            if (j != i)
+            {
+                mSecondDiffMatrix(i, j) = 2.0 * mDiffMatrix(i, j) * (mDiffMatrix(i, i) - 1.0 / (mNodes(i) - mNodes(j)));
+                diagonalSum += mSecondDiffMatrix(i, j);
+            }
+        }
+
+        mSecondDiffMatrix(i, i) = -diagonalSum;
+    }
+}
+
+#pragma endregion
+
+
+#pragma region Calculations
+
+void ChebyshevCollocation::differentiate(const Array<double>& values, Array<double>& derivativesDest) const
+{
+    for (arr_size_t i = 0; i < mPointsNum; i++)
+    {
+        double result = 0.0;
+
+        for (arr_size_t j = 0; j < mPointsNum; j++)
+        {
+            result += mDiffMatrix(i, j) * values(j);
+        }
+
+        derivativesDest(i) = result;
+    }
+}
+
+
+void ChebyshevCollocation::calcCoefficients(const Array<double>& values, Array<double>& coefficientsDest) const
+{
+    arr_size_t splitsNum = mPointsNum - 1;
+
+    for (arr_size_t j = 0; j < mPointsNum; j++)
+    {
+        double result = 0.0;
+
+        for (arr_size_t k = 0; k < mPointsNum; k++)
+        {
+            double tmp = values(k) * cos(M_PI * j * k / splitsNum);
+            result += (k == 0 || k == splitsNum) ? 0.5 * tmp : tmp;
+        }
+
+        coefficientsDest(j) = ((j == 0 || j == splitsNum) ? 1.0 : 2.0) * result / splitsNum;
+    }
+}
+
+
+Vector2<double> ChebyshevCollocation::interpolate(const Array<Vector2<double>>& values, double node)
+{
+    arr_size_t splitsNum = values.size() - 1;
+    Vector2<double> numerator;
+    double denominator = 0.0;
+
+    for (arr_size_t k = 0; k <= splitsNum; k++)
+    {
+        double dif = node - chebyshev_node(k, splitsNum);
+
+        if (dif == 0.0)
+        {
+            return values(k);
+        }
+
+        double tmp = barycentric_weight(k, splitsNum) / dif;
+
+        numerator += tmp * values(k);
+        denominator += tmp;
+    }
+
+    return numerator / denominator;
+}
+
+#pragma endregion
@@ -0,0 +1,57 @@
+#ifndef DIPLOMA_CHEBYSHEV_COLLOCATION_H
+#define DIPLOMA_CHEBYSHEV_COLLOCATION_H
+
+#ifndef SIGNED_ARR_SIZE
+    #define SIGNED_ARR_SIZE
+#endif
+
+
+#include "Matrix.h"
+
+
+// Chebyshev-Gauss-Lobatto collocation on [0, 1] with nodes s(k) = (1 - cos(pi k / N)) / 2, k = 0..N.
+// Node k lies at parameter k / N of the cosine map, which does not depend on N, so nodes of
+// different resolutions are matched by the same index parameter as uniform ones.
+class ChebyshevCollocation
+{
+public:
+    ChebyshevCollocation(arr_size_t pointsNum);
+
+
+    arr_size_t pointsNum() const;
+
+    double node(arr_size_t index) const;
+
+    double quadratureWeight(arr_size_t index) const;
+
+    const Matrix<double>& diffMatrix() const;
+
+    const Matrix<double>& secondDiffMatrix() const;
+
+
+    void differentiate(const Array<double>& values, Array<double>& derivativesDest) const;
+
+    void calcCoefficients(const Array<double>& values, Array<double>& coefficientsDest) const;
+
+
+    static Vector2<double> interpolate(const Array<Vector2<double>>& values, double node);
+
+private:
+    arr_size_t mPointsNum;
+
+    Array<double> mNodes;
+    Array<double> mBarycentricWeights;
+    Array<double> mQuadratureWeights;
+
+    Matrix<double> mDiffMatrix;
+    Matrix<double> mSecondDiffMatrix;
+
+
+    void calcNodes();
+
+    void calcQuadratureWeights();
+
+    void calcDiffMatrices();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "DenseLUSolver.h"
+#include "console_util.h"
+#include <algorithm>
+
+
+#pragma region Constructors
+
+DenseLUSolver::DenseLUSolver(arr_size_t size, bool isPedantic)
+    : mMatrix(size, size), mFactors(size, size), mConstTerms(size), mPivots(size),
+      mSize(size), mIsPedantic(isPedantic), mIsFactorized(false) {}
+
+#pragma endregion
+
+
+#pragma region Solver parameters
+
+arr_size_t DenseLUSolver::size() const
+{
+    return mSize;
+}
+
+#pragma endregion
+
+
+#pragma region Access methods
+
+double& DenseLUSolver::operator()(arr_size_t row, arr_size_t column)
+{
+    assert_message(row >= 0 && row < mSize && column >= 0 && column < mSize, "Dense LU solver index out of bounds");
+
+    mIsFactorized = false;
+
+    return mMatrix(row, column);
+}
+
+
+double& DenseLUSolver::constTerm(arr_size_t row)
+{
+    assert_message(row >= 0 && row < mSize, "Dense LU solver index out of bounds");
+
+    return mConstTerms(row);
+}
+
+#pragma endregion
+
+
+#pragma region Public solve methods
+
+bool DenseLUSolver::factorize()
+{
+    mFactors = mMatrix;
+
+    // Doolittle factorization in place, L has unit diagonal and is stored below the main diagonal
+    for (arr_size_t k = 0; k < mSize; k++)
+    {
+        arr_size_t pivot = k;
+
+        for (arr_size_t i = k + 1; i < mSize; i++)
+        {
+            if (std::abs(mFactors(i, k)) > std::abs(mFactors(pivot, k)))
+            {
+                pivot = i;
+            }
+        }
+
+        mPivots[k] = pivot;
+
+        if (mFactors(pivot, k) == 0.0 || !std::isfinite(mFactors(pivot, k)))
+        {
+            if (mIsPedantic)
+            {
+                assert_message(false, "Dense LU solver matrix is singular!");
+            }
+            else
+            {
+                print_message("! Warning: Dense LU solver matrix is singular ! \n");
+            }
+
+            mIsFactorized = false;
+            return false;
+        }
+
+        if (pivot != k)
+        {
+            for (arr_size_t j = 0; j < mSize; j++)
+            {
+                std::swap(mFactors(k, j), mFactors(pivot, j));
+            }
+        }
+
+        double invPivot = 1.0 / mFactors(k, k);
+
+        for (arr_size_t i = k + 1; i < mSize; i++)
+        {
+            double coef = mFactors(i, k) * invPivot;
+
+            mFactors(i, k) = coef;
+
+            for (arr_size_t j = k + 1; j < mSize; j++)
+            {
+                mFactors(i, j) -= coef * mFactors(k, j);
+            }
+        }
+    }
+
+    mIsFactorized = true;
+    return true;
+}
+
+
+bool DenseLUSolver::isFactorized() const
+{
+    return mIsFactorized;
+}
+
+
+Array<double> DenseLUSolver::solve()
+{
+    Array<double> solution(mSize);
+
+    this->solve(solution);
+
+    return solution;
+}
+
+
+void DenseLUSolver::solve(Array<double>& solutionDest)
+{
+    assert_message(mSize == solutionDest.size(),
+                   "Dense LU solution cannot be calculated due to different size of solution destination");
+
+    if (!mIsFactorized)
+    {
+        factorize();
+    }
+
+    for (arr_size_t i = 0; i < mSize; i++)
+    {
+        solutionDest(i) = mConstTerms(i);
+    }
+
+    for (arr_size_t k = 0; k < mSize; k++)
+    {
+        std::swap(solutionDest(k), solutionDest(mPivots[k]));
+    }
+
+    for (arr_size_t i = 1; i < mSize; i++)
+    {
+        double sum = solutionDest(i);
+
+        for (arr_size_t j = 0; j < i; j++)
+        {
+            sum -= mFactors(i, j) * solutionDest(j);
+        }
+
+        solutionDest(i) = sum;
+    }
+
+    for (arr_size_t i = mSize - 1; i >= 0; i--)
+    {
+        double sum = solutionDest(i);
+
+        for (arr_size_t j = i + 1; j < mSize; j++)
+        {
+            sum -= mFactors(i, j) * solutionDest(j);
+        }
+
+        solutionDest(i) = sum / mFactors(i, i);
+    }
+}
+
+#pragma endregion
@@ -0,0 +1,52 @@
+#ifndef DIPLOMA_DENSE_LU_SOLVER_H
+#define DIPLOMA_DENSE_LU_SOLVER_H
+
+#ifndef SIGNED_ARR_SIZE
+    #define SIGNED_ARR_SIZE
+#endif
+
+
+#include <vector>
+#include "Matrix.h"
+
+
+// LU factorization with partial pivoting for small dense systems.
+// As in RightSweep, factorization is kept until the matrix is changed, so systems with constant
+// matrix and changing constant terms are solved by substitutions only.
+class DenseLUSolver
+{
+public:
+    DenseLUSolver(arr_size_t size, bool isPedantic = false);
+
+
+    arr_size_t size() const;
+
+
+    double& operator()(arr_size_t row, arr_size_t column);
+
+    double& constTerm(arr_size_t row);
+
+
+    bool factorize();
+
+    bool isFactorized() const;
+
+
+    Array<double> solve();
+
+    void solve(Array<double>& solutionDest);
+
+private:
+    Matrix<double> mMatrix;
+    Matrix<double> mFactors;
+    Array<double> mConstTerms;
+
+    std::vector<arr_size_t> mPivots;
+
+    arr_size_t mSize;
+
+    bool mIsPedantic;
+    bool mIsFactorized;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "GMRESSolver.h"
+#include <algorithm>
+
+
+#pragma region Vector operations
+
+static double dot_product(const Array<double>& l, const Array<double>& r)
+{
+    double result = 0.0;
+    arr_size_t size = l.size();
+
+    for (arr_size_t i = 0; i < size; i++)
+    {
+        result += l(i) * r(i);
+    }
+
+    return result;
+}
+
+#pragma endregion
+
+
+#pragma region Constructors
+
+GMRESSolver::GMRESSolver(arr_size_t size, int restartSize)
+    : mSize(size),
+      mRestartSize(std::max(restartSize, 1)),
+      mIterationsNum(0),
+      mRelativeResidualNorm(0.0),
+      mBasis(std::max(restartSize, 1) + 1, Array<double>(size)),
+      mHessenberg((std::max(restartSize, 1) + 1) * std::max(restartSize, 1), 0.0),
+      mCos(std::max(restartSize, 1), 0.0),
+      mSin(std::max(restartSize, 1), 0.0),
+      mLeastSquaresTerms(std::max(restartSize, 1) + 1, 0.0),
+      mProduct(size),
+      mResidual(size)
+{}
+
+#pragma endregion
+
+
+#pragma region Parameters
+
+arr_size_t GMRESSolver::size() const
+{
+    return mSize;
+}
+
+
+int GMRESSolver::restartSize() const
+{
+    return mRestartSize;
+}
+
+
+int GMRESSolver::iterationsNum() const
+{
+    return mIterationsNum;
+}
+
+
+double GMRESSolver::relativeResidualNorm() const
+{
+    return mRelativeResidualNorm;
+}
+
+#pragma endregion
+
+
+#pragma region Main calculations
+
+bool GMRESSolver::solve(const LinearOperator& linearOperator,
+                        const Array<double>& constTerms,
+                        Array<double>& solutionDest,
+                        double relativeTolerance,
+                        int iterationsMaxNum)
+{
+    assert_message(constTerms.size() == mSize && solutionDest.size() == mSize,
+                   "GMRES cannot be calculated for arrays of different sizes");
+
+    double constTermsNorm = std::sqrt(dot_product(constTerms, constTerms));
+
+    mIterationsNum = 0;
+    mRelativeResidualNorm = 0.0;
+
+    // solution always starts from zero, so the first residual is the constant terms vector
+    for (arr_size_t i = 0; i < mSize; i++)
+    {
+        solutionDest(i) = 0.0;
+        mResidual(i) = constTerms(i);
+    }
+
+    if (constTermsNorm == 0.0)
+    {
+        return true;
+    }
+
+    double residualNorm = constTermsNorm;
+
+    while (true)
+    {
+        int basisSize = 0;
+
+        std::fill(mLeastSquaresTerms.begin(), mLeastSquaresTerms.end(), 0.0);
+        mLeastSquaresTerms[0] = residualNorm;
+
+        for (arr_size_t i = 0; i < mSize; i++)
+        {
+            mBasis[0](i) = mResidual(i) / residualNorm;
+        }
+
+        for (int j = 0; j < mRestartSize; j++)
+        {
+            Array<double>& nextBasisVector = mBasis[j + 1];
+
+            if (!linearOperator(mBasis[j], nextBasisVector))
+            {
+                return false;
+            }
+
+            mIterationsNum++;
+
+            for (int i = 0; i <= j; i++)
+            {
+                hessenberg(i, j) = dot_product(nextBasisVector, mBasis[i]);
+
+                for (arr_size_t k = 0; k < mSize; k++)
+                {
+                    nextBasisVector(k) -= hessenberg(i, j) * mBasis[i](k);
+                }
+            }
+
+            hessenberg(j + 1, j) = std::sqrt(dot_product(nextBasisVector, nextBasisVector));
+
+            for (int i = 0; i < j; i++)
+            {
+                double tmp = mCos[i] * hessenberg(i, j) + mSin[i] * hessenberg(i + 1, j);
+
+                hessenberg(i + 1, j) = -mSin[i] * hessenberg(i, j) + mCos[i] * hessenberg(i + 1, j);
+                hessenberg(i, j) = tmp;
+            }
+
+            double diagonal = std::hypot(hessenberg(j, j), hessenberg(j + 1, j));
+            bool isBreakdown = hessenberg(j + 1, j) == 0.0;
+
+            if (diagonal == 0.0 || !std::isfinite(diagonal))
+            {
+                break;
+            }
+
+            if (!isBreakdown)
+            {
+                for (arr_size_t k = 0; k < mSize; k++)
+                {
+                    nextBasisVector(k) /= hessenberg(j + 1, j);
+                }
+            }
+
+            mCos[j] = hessenberg(j, j) / diagonal;
+            mSin[j] = hessenberg(j + 1, j) / diagonal;
+
+            hessenberg(j, j) = diagonal;
+            hessenberg(j + 1, j) = 0.0;
+
+            mLeastSquaresTerms[j + 1] = -mSin[j] * mLeastSquaresTerms[j];
+            mLeastSquaresTerms[j] *= mCos[j];
+
+            basisSize = j + 1;
+            residualNorm = std::abs(mLeastSquaresTerms[j + 1]);
+
+            if (isBreakdown || residualNorm <= relativeTolerance * constTermsNorm || mIterationsNum >= iterationsMaxNum)
+            {
+                break;
+            }
+        }
+
+        updateSolution(basisSize, solutionDest);
+
+        mRelativeResidualNorm = residualNorm / constTermsNorm;
+
+        if (basisSize < mRestartSize || residualNorm <= relativeTolerance * constTermsNorm ||
+            mIterationsNum >= iterationsMaxNum)
+        {
+            return true;
+        }
+
+        // restart from the true residual of the current solution
+        if (!linearOperator(solutionDest, mProduct))
+        {
+            return false;
+        }
+
+        mIterationsNum++;
+
+        for (arr_size_t i = 0; i < mSize; i++)
+        {
+            mResidual(i) = constTerms(i) - mProduct(i);
+        }
+
+        residualNorm = std::sqrt(dot_product(mResidual, mResidual));
+
+        if (residualNorm == 0.0)
+        {
+            mRelativeResidualNorm = 0.0;
+            return true;
+        }
+    }
+}
+
+#pragma endregion
+
+
+#pragma region Private calculation methods
+
+double& GMRESSolver::hessenberg(int row, int column)
+{
+    return mHessenberg[row * mRestartSize + column];
+}
+
+
+void GMRESSolver::updateSolution(int basisSize, Array<double>& solutionDest)
+{
+    std::vector<double> coefs(mLeastSquaresTerms.begin(), mLeastSquaresTerms.begin() + basisSize);
+
+    // rotated Hessenberg matrix is upper triangular
+    for (int i = basisSize - 1; i >= 0; i--)
+    {
+        for (int j = i + 1; j < basisSize; j++)
+        {
+            coefs[i] -= hessenberg(i, j) * coefs[j];
+        }
+
+        coefs[i] /= hessenberg(i, i);
+    }
+
+    for (int i = 0; i < basisSize; i++)
+    {
+        for (arr_size_t k = 0; k < mSize; k++)
+        {
+            solutionDest(k) += coefs[i] * mBasis[i](k);
+        }
+    }
+}
+
+#pragma endregion
@@ -0,0 +1,66 @@
+#ifndef DIPLOMA_GMRES_SOLVER_H
+#define DIPLOMA_GMRES_SOLVER_H
+
+#ifndef SIGNED_ARR_SIZE
+    #define SIGNED_ARR_SIZE
+#endif
+
+
+#include <vector>
+#include <functional>
+#include "Array.h"
+
+
+// Product of the system matrix with the first argument is written to the second one,
+// false is returned when the product cannot be calculated
+typedef std::function<bool(const Array<double>& vector, Array<double>& productDest)> LinearOperator;
+
+
+// Restarted GMRES(m) for systems given only by matrix-vector products.
+// Krylov basis is orthogonalized by modified Gram-Schmidt, least squares problem is updated
+// by Givens rotations, so the residual norm is known after every product.
+class GMRESSolver
+{
+public:
+    GMRESSolver(arr_size_t size, int restartSize);
+
+
+    arr_size_t size() const;
+
+    int restartSize() const;
+
+    int iterationsNum() const;
+
+    double relativeResidualNorm() const;
+
+
+    bool solve(const LinearOperator& linearOperator,
+               const Array<double>& constTerms,
+               Array<double>& solutionDest,
+               double relativeTolerance,
+               int iterationsMaxNum);
+
+private:
+    arr_size_t mSize;
+
+    int mRestartSize;
+    int mIterationsNum;
+
+    double mRelativeResidualNorm;
+
+    std::vector<Array<double>> mBasis;
+    std::vector<double> mHessenberg;
+    std::vector<double> mCos;
+    std::vector<double> mSin;
+    std::vector<double> mLeastSquaresTerms;
+
+    Array<double> mProduct;
+    Array<double> mResidual;
+
+
+    double& hessenberg(int row, int column);
+
+    void updateSolution(int basisSize, Array<double>& solutionDest);
+};
+
+#endif
\ No newline at end of file
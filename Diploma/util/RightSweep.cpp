@@ -1,12 +1,28 @@
 #include "RightSweep.h"
+#include "console_util.h"
+#include <algorithm>
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+
+// systems shorter than this are swept serially, partitioning only pays off for very fine fluid grids
+static const arr_size_t PARALLEL_SWEEP_MIN_SIZE = 65536;
+static const arr_size_t PARALLEL_SWEEP_MIN_BLOCK_SIZE = 16384;
+static const double PARALLEL_SWEEP_TOLERANCE = 1e-9;
 
 
 #pragma region Constructors
 
 RightSweep::RightSweep(arr_size_t size, bool isPedantic) : mLowerDiagonal(size - 1), mMainDiagonal(size), 
                                                            mUpperDiagonal(size - 1), mConstTerms(size),
-                                                           mAlpha(size - 1), mBeta(size), 
-                                                           mSize(size), mIsPedantic(isPedantic) {}
+                                                           mAlpha(size - 1), mBeta(size), mInvDenominators(size), 
+                                                           mBlockBegins(), mBlockEnds(), mBlockAlpha(), 
+                                                           mBlockInvDenominators(), mLeftSpikes(), mRightSpikes(), 
+                                                           mReducedLowerDiagonal(), mReducedAlpha(), 
+                                                           mReducedInvDenominators(), mReducedBeta(), 
+                                                           mSize(size), mIsPedantic(isPedantic), mIsFactorized(false) {}
 
 #pragma endregion
 
@@ -29,14 +45,17 @@ double& RightSweep::operator()(RightSweepAccessType accessType, arr_size_t index
     {
         case RS_LOWER_DIAGONAL:
             assert_message(index >= 0 && index < mLowerDiagonal.size(), "Right sweep lower diagonal index out of bounds");
+            mIsFactorized = false;
             return mLowerDiagonal(index);
 
         case RS_MAIN_DIAGONAL:
             assert_message(index >= 0 && index < mMainDiagonal.size(), "Right sweep main diagonal index out of bounds");
+            mIsFactorized = false;
             return mMainDiagonal(index);
 
         case RS_UPPER_DIAGONAL:
             assert_message(index >= 0 && index < mUpperDiagonal.size(), "Right sweep upper diagonal index out of bounds");
+            mIsFactorized = false;
             return mUpperDiagonal(index);
 
         case RS_CONST_TERMS:
@@ -49,11 +68,106 @@ double& RightSweep::operator()(RightSweepAccessType accessType, arr_size_t index
     }
 }
 
+
+double* RightSweep::diagonal(RightSweepAccessType accessType)
+{
+    switch (accessType)
+    {
+        case RS_LOWER_DIAGONAL:
+            mIsFactorized = false;
+            return mLowerDiagonal.data();
+
+        case RS_MAIN_DIAGONAL:
+            mIsFactorized = false;
+            return mMainDiagonal.data();
+
+        case RS_UPPER_DIAGONAL:
+            mIsFactorized = false;
+            return mUpperDiagonal.data();
+
+        case RS_CONST_TERMS:
+            return mConstTerms.data();
+
+        default:
+            assert_message(false, "Right sweep unknown access type");
+            return nullptr;
+    }
+}
+
+
+const double* RightSweep::diagonal(RightSweepAccessType accessType) const
+{
+    switch (accessType)
+    {
+        case RS_LOWER_DIAGONAL:
+            return mLowerDiagonal.data();
+
+        case RS_MAIN_DIAGONAL:
+            return mMainDiagonal.data();
+
+        case RS_UPPER_DIAGONAL:
+            return mUpperDiagonal.data();
+
+        case RS_CONST_TERMS:
+            return mConstTerms.data();
+
+        default:
+            assert_message(false, "Right sweep unknown access type");
+            return nullptr;
+    }
+}
+
+
+arr_size_t RightSweep::diagonalSize(RightSweepAccessType accessType) const
+{
+    return (accessType == RS_LOWER_DIAGONAL || accessType == RS_UPPER_DIAGONAL) ? mSize - 1 : mSize;
+}
+
 #pragma endregion
 
 
 #pragma region Public solve methods
 
+void RightSweep::factorize()
+{
+    if (!isValid())
+    {
+        if (mIsPedantic)
+        {
+            assert_message(false, "Right sweep matrix is invalid!");
+        }
+        else
+        {
+            print_message("! Warning: Right sweep matrix is invalid ! \n");
+        }
+    }
+
+    int blocksNum = calcBlocksNum();
+
+    calcBlocks(blocksNum);
+
+    if (blocksNum > 1)
+    {
+        calcSpikes();
+        calcReducedAlpha();
+    }
+
+    // serial coefficients are also kept in pedantic mode to check partitioned solutions
+    if (blocksNum == 1 || mIsPedantic)
+    {
+        calcAlpha();
+    }
+
+    mIsFactorized = true;
+}
+
+
+bool RightSweep::isFactorized() const
+{
+    return mIsFactorized;
+}
+
+
 Array<double> RightSweep::solve()
 {
     Array<double> solution(mSize);
@@ -69,21 +183,26 @@ void RightSweep::solve(Array<double>& solutionDest)
     assert_message(mSize == solutionDest.size(), 
                    "Right sweep solution cannot be calculated due to different size of solution destination");
 
-    if (!isValid())
+    // elimination coefficients depend on the matrix only, constant terms are swept on every solve
+    if (!mIsFactorized)
     {
+        factorize();
+    }
+
+    if (mBlockBegins.size() > 1)
+    {
+        parallelSolve(solutionDest);
+
         if (mIsPedantic)
         {
-            assert_message(false, "Right sweep matrix is invalid!");
-        }
-        else
-        {
-            printf("! Warning: Right sweep matrix is invalid ! \n");
+            checkParallelSolution(solutionDest);
         }
     }
-
-    calcAlpha();
-    calcBeta();
-    reversal(solutionDest);
+    else
+    {
+        calcBeta();
+        reversal(solutionDest);
+    }
 }
 
 #pragma endregion
@@ -95,27 +214,30 @@ void RightSweep::calcAlpha()
 {
     arr_size_t limit = mSize - 1;
 
-    mAlpha(0) = -mUpperDiagonal(0) / mMainDiagonal(0);
+    mInvDenominators(0) = 1.0 / mMainDiagonal(0);
+    mAlpha(0) = -mUpperDiagonal(0) * mInvDenominators(0);
 
     #pragma loop(no_parallel)
     #pragma loop(no_vector)
     for (arr_size_t i = 1; i < limit; i++)
     {
-        mAlpha(i) = -mUpperDiagonal(i) / (mMainDiagonal(i) + mLowerDiagonal(i - 1) * mAlpha(i - 1));
+        mInvDenominators(i) = 1.0 / (mMainDiagonal(i) + mLowerDiagonal(i - 1) * mAlpha(i - 1));
+        mAlpha(i) = -mUpperDiagonal(i) * mInvDenominators(i);
     }
+
+    mInvDenominators(limit) = 1.0 / (mMainDiagonal(limit) + mLowerDiagonal(limit - 1) * mAlpha(limit - 1));
 }
 
 
 void RightSweep::calcBeta()
 {
-    mBeta(0) = mConstTerms(0) / mMainDiagonal(0);
+    mBeta(0) = mConstTerms(0) * mInvDenominators(0);
 
     #pragma loop(no_parallel)
     #pragma loop(no_vector)
     for (arr_size_t i = 1; i < mSize; i++)
     {
-        mBeta(i) = (mConstTerms(i) - mLowerDiagonal(i - 1) * mBeta(i - 1)) /
-                   (mMainDiagonal(i) + mLowerDiagonal(i - 1) * mAlpha(i - 1));
+        mBeta(i) = (mConstTerms(i) - mLowerDiagonal(i - 1) * mBeta(i - 1)) * mInvDenominators(i);
     }
 }
 
@@ -135,6 +257,213 @@ void RightSweep::reversal(Array<double>& solutionDest)
 #pragma endregion
 
 
+#pragma region Parallel calculation methods
+
+int RightSweep::calcBlocksNum() const
+{
+#ifdef _OPENMP
+    if (mSize >= PARALLEL_SWEEP_MIN_SIZE)
+    {
+        return std::max(1, std::min(omp_get_max_threads(), (int)(mSize / PARALLEL_SWEEP_MIN_BLOCK_SIZE)));
+    }
+#endif
+
+    return 1;
+}
+
+
+void RightSweep::calcBlocks(int blocksNum)
+{
+    mBlockBegins.assign(blocksNum, 0);
+    mBlockEnds.assign(blocksNum, mSize);
+
+    // every block but the last one is followed by a separator row coupling it with the next block
+    for (int p = 0; p < blocksNum - 1; p++)
+    {
+        mBlockEnds[p] = (arr_size_t)((long long)(p + 1) * mSize / blocksNum);
+        mBlockBegins[p + 1] = mBlockEnds[p] + 1;
+    }
+}
+
+
+void RightSweep::calcSpikes()
+{
+    int blocksNum = (int)mBlockBegins.size();
+    const double* lowerDiagonal = mLowerDiagonal.data();
+    const double* mainDiagonal = mMainDiagonal.data();
+    const double* upperDiagonal = mUpperDiagonal.data();
+
+    mBlockAlpha.assign(mSize, 0.0);
+    mBlockInvDenominators.assign(mSize, 0.0);
+    mLeftSpikes.assign(mSize, 0.0);
+    mRightSpikes.assign(mSize, 0.0);
+
+    // block solution is y + v * x(left separator) + w * x(right separator), spikes v and w
+    // do not depend on constant terms and are calculated once per factorization
+    #pragma omp parallel for schedule(static, 1)
+    for (int p = 0; p < blocksNum; p++)
+    {
+        arr_size_t begin = mBlockBegins[p];
+        arr_size_t end = mBlockEnds[p];
+        double* alpha = mBlockAlpha.data();
+        double* invDenominators = mBlockInvDenominators.data();
+        double* leftSpike = mLeftSpikes.data();
+        double* rightSpike = mRightSpikes.data();
+
+        invDenominators[begin] = 1.0 / mainDiagonal[begin];
+
+        for (arr_size_t i = begin + 1; i < end; i++)
+        {
+            alpha[i - 1] = -upperDiagonal[i - 1] * invDenominators[i - 1];
+            invDenominators[i] = 1.0 / (mainDiagonal[i] + lowerDiagonal[i - 1] * alpha[i - 1]);
+        }
+
+        if (p > 0)
+        {
+            leftSpike[begin] = -lowerDiagonal[begin - 1] * invDenominators[begin];
+
+            for (arr_size_t i = begin + 1; i < end; i++)
+            {
+                leftSpike[i] = -lowerDiagonal[i - 1] * leftSpike[i - 1] * invDenominators[i];
+            }
+
+            for (arr_size_t i = end - 2; i >= begin; i--)
+            {
+                leftSpike[i] += alpha[i] * leftSpike[i + 1];
+            }
+        }
+
+        if (p < blocksNum - 1)
+        {
+            rightSpike[end - 1] = -upperDiagonal[end - 1] * invDenominators[end - 1];
+
+            for (arr_size_t i = end - 2; i >= begin; i--)
+            {
+                rightSpike[i] = alpha[i] * rightSpike[i + 1];
+            }
+        }
+    }
+}
+
+
+void RightSweep::calcReducedAlpha()
+{
+    int separatorsNum = (int)mBlockBegins.size() - 1;
+
+    mReducedLowerDiagonal.assign(separatorsNum, 0.0);
+    mReducedAlpha.assign(separatorsNum, 0.0);
+    mReducedInvDenominators.assign(separatorsNum, 0.0);
+    mReducedBeta.assign(separatorsNum, 0.0);
+
+    double prevAlpha = 0.0;
+
+    // separator rows with neighbouring block unknowns eliminated form a tridiagonal system
+    for (int q = 0; q < separatorsNum; q++)
+    {
+        arr_size_t s = mBlockEnds[q];
+
+        double lower = mLowerDiagonal(s - 1) * mLeftSpikes[s - 1];
+        double main = mMainDiagonal(s) + mLowerDiagonal(s - 1) * mRightSpikes[s - 1] + mUpperDiagonal(s) * mLeftSpikes[s + 1];
+        double upper = mUpperDiagonal(s) * mRightSpikes[s + 1];
+
+        mReducedLowerDiagonal[q] = lower;
+        mReducedInvDenominators[q] = 1.0 / (main + lower * prevAlpha);
+        mReducedAlpha[q] = -upper * mReducedInvDenominators[q];
+
+        prevAlpha = mReducedAlpha[q];
+    }
+}
+
+
+void RightSweep::parallelSolve(Array<double>& solutionDest)
+{
+    int blocksNum = (int)mBlockBegins.size();
+    int separatorsNum = blocksNum - 1;
+    const double* lowerDiagonal = mLowerDiagonal.data();
+    const double* upperDiagonal = mUpperDiagonal.data();
+    const double* constTerms = mConstTerms.data();
+    const double* alpha = mBlockAlpha.data();
+    const double* invDenominators = mBlockInvDenominators.data();
+    double* solution = solutionDest.data();
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int p = 0; p < blocksNum; p++)
+    {
+        arr_size_t begin = mBlockBegins[p];
+        arr_size_t end = mBlockEnds[p];
+
+        solution[begin] = constTerms[begin] * invDenominators[begin];
+
+        for (arr_size_t i = begin + 1; i < end; i++)
+        {
+            solution[i] = (constTerms[i] - lowerDiagonal[i - 1] * solution[i - 1]) * invDenominators[i];
+        }
+
+        for (arr_size_t i = end - 2; i >= begin; i--)
+        {
+            solution[i] += alpha[i] * solution[i + 1];
+        }
+    }
+
+    double prevBeta = 0.0;
+
+    for (int q = 0; q < separatorsNum; q++)
+    {
+        arr_size_t s = mBlockEnds[q];
+        double constTerm = constTerms[s] - lowerDiagonal[s - 1] * solution[s - 1] - upperDiagonal[s] * solution[s + 1];
+
+        mReducedBeta[q] = (constTerm - mReducedLowerDiagonal[q] * prevBeta) * mReducedInvDenominators[q];
+        prevBeta = mReducedBeta[q];
+    }
+
+    solution[mBlockEnds[separatorsNum - 1]] = mReducedBeta[separatorsNum - 1];
+
+    for (int q = separatorsNum - 2; q >= 0; q--)
+    {
+        solution[mBlockEnds[q]] = mReducedAlpha[q] * solution[mBlockEnds[q + 1]] + mReducedBeta[q];
+    }
+
+    #pragma omp parallel for schedule(static, 1)
+    for (int p = 0; p < blocksNum; p++)
+    {
+        arr_size_t begin = mBlockBegins[p];
+        arr_size_t end = mBlockEnds[p];
+        double leftValue = (p > 0) ? solution[begin - 1] : 0.0;
+        double rightValue = (p < blocksNum - 1) ? solution[end] : 0.0;
+
+        for (arr_size_t i = begin; i < end; i++)
+        {
+            solution[i] += mLeftSpikes[i] * leftValue + mRightSpikes[i] * rightValue;
+        }
+    }
+}
+
+
+void RightSweep::checkParallelSolution(const Array<double>& solution)
+{
+    Array<double> serialSolution(mSize);
+    double maxDeviation = 0.0;
+    double maxValue = 0.0;
+
+    calcBeta();
+    reversal(serialSolution);
+
+    for (arr_size_t i = 0; i < mSize; i++)
+    {
+        maxDeviation = std::max(maxDeviation, std::abs(solution(i) - serialSolution(i)));
+        maxValue = std::max(maxValue, std::abs(serialSolution(i)));
+    }
+
+    if (maxDeviation > PARALLEL_SWEEP_TOLERANCE * std::max(1.0, maxValue))
+    {
+        print_message("Right sweep parallel solution deviates from serial one by %e\n", maxDeviation);
+        assert_message(false, "Right sweep parallel solution is inaccurate!");
+    }
+}
+
+#pragma endregion
+
+
 #pragma region Validation
 
 bool RightSweep::isValid() const
@@ -9,6 +9,7 @@
 #endif
 
 
+#include <vector>
 #include "Array.h"
 
 
@@ -21,6 +22,15 @@ enum RightSweepAccessType
 };
 
 
+typedef struct right_sweep_row_t
+{
+    double lower;
+    double main;
+    double upper;
+    double constTerm;
+} RightSweepRow;
+
+
 class RightSweep
 {
 public:
@@ -33,6 +43,24 @@ public:
     double& operator()(RightSweepAccessType accessType, arr_size_t index);
 
 
+    double* diagonal(RightSweepAccessType accessType);
+
+    const double* diagonal(RightSweepAccessType accessType) const;
+
+    arr_size_t diagonalSize(RightSweepAccessType accessType) const;
+
+    template <typename Generator>
+    void fill(RightSweepAccessType accessType, arr_size_t beginIndex, arr_size_t endIndex, Generator generator);
+
+    template <typename Generator>
+    void fillRows(arr_size_t beginIndex, arr_size_t endIndex, Generator generator);
+
+
+    void factorize();
+
+    bool isFactorized() const;
+
+
     Array<double> solve();
     
     void solve(Array<double>& solutionDest);
@@ -45,10 +73,23 @@ private:
     
     Array<double> mAlpha;
     Array<double> mBeta;
+    Array<double> mInvDenominators;
+
+    std::vector<arr_size_t> mBlockBegins;
+    std::vector<arr_size_t> mBlockEnds;
+    std::vector<double> mBlockAlpha;
+    std::vector<double> mBlockInvDenominators;
+    std::vector<double> mLeftSpikes;
+    std::vector<double> mRightSpikes;
+    std::vector<double> mReducedLowerDiagonal;
+    std::vector<double> mReducedAlpha;
+    std::vector<double> mReducedInvDenominators;
+    std::vector<double> mReducedBeta;
     
     arr_size_t mSize;
     
     bool mIsPedantic;
+    bool mIsFactorized;
     
     
     void calcAlpha();
@@ -56,9 +97,25 @@ private:
     void calcBeta();
     
     void reversal(Array<double>& solutionDest);
+
+
+    int calcBlocksNum() const;
+
+    void calcBlocks(int blocksNum);
+
+    void calcSpikes();
+
+    void calcReducedAlpha();
+
+    void parallelSolve(Array<double>& solutionDest);
+
+    void checkParallelSolution(const Array<double>& solution);
+    
     
     bool isValid() const;
 };
 
 
+#include "RightSweep.tpp"
+
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "RightSweep.h"
+#include "debug_info.h"
+
+
+#pragma region Bulk access methods
+
+template <typename Generator>
+void RightSweep::fill(RightSweepAccessType accessType, arr_size_t beginIndex, arr_size_t endIndex, Generator generator)
+{
+    assert_message(beginIndex >= 0 && endIndex <= diagonalSize(accessType) && beginIndex <= endIndex, 
+                   "Right sweep fill range out of bounds");
+
+    // bounds are checked once for the whole range, so the loop writes straight into contiguous storage
+    double* dest = diagonal(accessType);
+
+    for (arr_size_t i = beginIndex; i < endIndex; i++)
+    {
+        dest[i] = generator(i);
+    }
+}
+
+
+template <typename Generator>
+void RightSweep::fillRows(arr_size_t beginIndex, arr_size_t endIndex, Generator generator)
+{
+    assert_message(beginIndex >= 1 && endIndex <= mSize - 1 && beginIndex <= endIndex, 
+                   "Right sweep rows fill range out of bounds");
+
+    // row i couples unknowns i - 1, i and i + 1, its lower coefficient is stored at index i - 1
+    double* lowerDiagonal = mLowerDiagonal.data();
+    double* mainDiagonal = mMainDiagonal.data();
+    double* upperDiagonal = mUpperDiagonal.data();
+    double* constTerms = mConstTerms.data();
+
+    mIsFactorized = false;
+
+    for (arr_size_t i = beginIndex; i < endIndex; i++)
+    {
+        RightSweepRow row = generator(i);
+
+        lowerDiagonal[i - 1] = row.lower;
+        mainDiagonal[i] = row.main;
+        upperDiagonal[i] = row.upper;
+        constTerms[i] = row.constTerm;
+    }
+}
+
+#pragma endregion
@@ -47,6 +47,8 @@ public:
     
     double length() const;
 
+    Vector2<T>& operator=(const Vector2<T>& r);
+
     template <typename K>
     Vector2<T>& operator=(const Vector2<K>& r);
 
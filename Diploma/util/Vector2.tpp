@@ -68,6 +68,16 @@ inline double Vector2<T>::length() const
 
 #pragma region Assignment operators
 
+template <typename T>
+inline Vector2<T>& Vector2<T>::operator=(const Vector2<T>& r)
+{
+    x = r.x;
+    y = r.y;
+
+    return *this;
+}
+
+
 template <typename T>
 template <typename K>
 inline Vector2<T>& Vector2<T>::operator=(const Vector2<K>& r)
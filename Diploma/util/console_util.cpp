@@ -0,0 +1,80 @@
+#include "console_util.h"
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+
+static std::mutex output_mutex;
+static thread_local std::string messages_buffer;
+static thread_local bool is_messages_buffering = false;
+
+
+#pragma region Console messages
+
+void print_message(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    if (!is_messages_buffering)
+    {
+        std::lock_guard<std::mutex> lock(output_mutex);
+
+        vprintf(format, args);
+        va_end(args);
+
+        return;
+    }
+
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+
+    int length = vsnprintf(nullptr, 0, format, argsCopy);
+
+    va_end(argsCopy);
+
+    if (length > 0)
+    {
+        size_t offset = messages_buffer.size();
+
+        messages_buffer.resize(offset + length + 1);
+        vsnprintf(&messages_buffer[offset], length + 1, format, args);
+        messages_buffer.resize(offset + length);
+    }
+
+    va_end(args);
+}
+
+
+void start_messages_buffering()
+{
+    is_messages_buffering = true;
+}
+
+
+void flush_messages()
+{
+    if (messages_buffer.empty())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(output_mutex);
+
+        fputs(messages_buffer.c_str(), stdout);
+        fflush(stdout);
+    }
+
+    messages_buffer.clear();
+}
+
+
+void stop_messages_buffering()
+{
+    flush_messages();
+    is_messages_buffering = false;
+}
+
+#pragma endregion
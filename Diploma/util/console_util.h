@@ -0,0 +1,20 @@
+#ifndef DIPLOMA_CONSOLE_UTIL_H
+#define DIPLOMA_CONSOLE_UTIL_H
+
+
+#pragma region Console messages
+
+// Prints message immediately or appends it to the messages buffer of the calling thread
+void print_message(const char* format, ...);
+
+// Messages of the calling thread are collected and printed in whole blocks by flush_messages(),
+// so calculations running concurrently do not interleave their output
+void start_messages_buffering();
+
+void flush_messages();
+
+void stop_messages_buffering();
+
+#pragma endregion
+
+#endif
\ No newline at end of file
@@ -302,21 +302,8 @@ inline std::filesystem::path write_fluid_data(const FluidResultParams& fluidPara
 }
 
 
-static void write_field_data(const std::filesystem::path& path,
-                             const FieldResultParams& fieldParams,
-                             const Matrix<Vector2<double>>& points,
-                             const Matrix<double>& field) noexcept(false)
+static void write_field_header(std::ofstream& output, const FieldResultParams& fieldParams)
 {
-    std::ofstream output(path);
-
-    if (!output.good())
-    {
-        throw std::runtime_error("Cannot write data to file: " + path.string());
-    }
-
-    arr_size_t rowsNum = points.rowsNum();
-    arr_size_t columnsNum = points.columnsNum();
-
     write_comment_line(output, COLUMN_WIDTH, "Chi", 
                                              "Surface splits", 
                                              "Internal splits", 
@@ -341,6 +328,25 @@ static void write_field_data(const std::filesystem::path& path,
                                              fieldParams.potentialLabel);
     write_data(output, '#', 11 * COLUMN_WIDTH, "") << std::endl;
     write_comment_line(output, COLUMN_WIDTH, fieldParams.xLabel, fieldParams.yLabel, fieldParams.potentialLabel);
+}
+
+
+static void write_field_data(const std::filesystem::path& path,
+                             const FieldResultParams& fieldParams,
+                             const Matrix<Vector2<double>>& points,
+                             const Matrix<double>& field) noexcept(false)
+{
+    std::ofstream output(path);
+
+    if (!output.good())
+    {
+        throw std::runtime_error("Cannot write data to file: " + path.string());
+    }
+
+    arr_size_t rowsNum = points.rowsNum();
+    arr_size_t columnsNum = points.columnsNum();
+
+    write_field_header(output, fieldParams);
 
     for (arr_size_t i = 0; i < rowsNum; i++)
     {
@@ -368,6 +374,53 @@ inline std::filesystem::path write_field_data(const FieldResultParams& fieldPara
 }
 
 
+// Field sampled on a regular grid, rows are separated by blank lines as gnuplot grid data,
+// points outside of the field domain have NaN values
+static void write_sampled_field_data(const std::filesystem::path& path,
+                                     const FieldResultParams& fieldParams,
+                                     const Matrix<Vector2<double>>& points,
+                                     const Matrix<double>& field) noexcept(false)
+{
+    std::ofstream output(path);
+
+    if (!output.good())
+    {
+        throw std::runtime_error("Cannot write data to file: " + path.string());
+    }
+
+    arr_size_t rowsNum = points.rowsNum();
+    arr_size_t columnsNum = points.columnsNum();
+
+    write_field_header(output, fieldParams);
+
+    for (arr_size_t i = 0; i < rowsNum; i++)
+    {
+        for (arr_size_t j = 0; j < columnsNum; j++)
+        {
+            write_offsetted_data_line(output, DATA_LINE_OFFSET, COLUMN_WIDTH, points(i, j).x, points(i, j).y, field(i, j));
+        }
+
+        output << std::endl;
+    }
+
+    output.flush();
+    output.close();
+}
+
+
+inline std::filesystem::path write_sampled_field_data(const FieldResultParams& fieldParams,
+                                                      const Matrix<Vector2<double>>& points,
+                                                      const Matrix<double>& field)
+{
+    std::string fileName = generate_file_name("field", "dat", "-", "sampled", fieldParams.chi);
+    std::filesystem::path outputPath = intermediate_file_path(fileName);
+
+    write_sampled_field_data(outputPath, fieldParams, points, field);
+
+    return outputPath;
+}
+
+
 static void write_field_error_data(const std::filesystem::path& path,
                                    const FieldModelParams& modelParams,
                                    const Matrix<Vector2<double>>& points,
@@ -4,6 +4,7 @@
 #define _USE_MATH_DEFINES
 
 #include <math.h>
+#include <algorithm>
 #include "Vector2.h"
 #include "Array.h"
 #include "Matrix.h"
@@ -109,6 +110,32 @@ static T parametric_point(const Array<T>& points, double param)
     return lerp(points(prevIndex), points(nextIndex), localParam);
 }
 
+
+template <typename T>
+static T parametric_point(const Matrix<T>& points, double rowParam, double columnParam)
+{
+    static_assert(is_arithmetic_ext<T>::value, "Parametric point cannot be calculated for Matrix of this type");
+
+    const arr_size_t maxRowIndex = points.rowsNum() - 1;
+    const arr_size_t maxColumnIndex = points.columnsNum() - 1;
+
+    double rowPos = std::clamp(rowParam, 0.0, 1.0) * maxRowIndex;
+    double columnPos = std::clamp(columnParam, 0.0, 1.0) * maxColumnIndex;
+
+    arr_size_t prevRow = std::min((arr_size_t)rowPos, std::max(maxRowIndex - 1, (arr_size_t)0));
+    arr_size_t prevColumn = std::min((arr_size_t)columnPos, std::max(maxColumnIndex - 1, (arr_size_t)0));
+    arr_size_t nextRow = std::min(prevRow + 1, maxRowIndex);
+    arr_size_t nextColumn = std::min(prevColumn + 1, maxColumnIndex);
+
+    double localRowParam = rowPos - prevRow;
+    double localColumnParam = columnPos - prevColumn;
+
+    T prevRowPoint = lerp(points(prevRow, prevColumn), points(prevRow, nextColumn), localColumnParam);
+    T nextRowPoint = lerp(points(nextRow, prevColumn), points(nextRow, nextColumn), localColumnParam);
+
+    return lerp(prevRowPoint, nextRowPoint, localRowParam);
+}
+
 #pragma endregion
 
 #endif
\ No newline at end of file